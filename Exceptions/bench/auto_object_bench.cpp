@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stack>
+
+#include "macro_exceptions.h"
+
+// Cost of an AUTO_OBJECT on the happy path (nothing thrown):
+// the intrusive cleanup chain vs the previous scheme, where every object
+// registered a heap-allocated scope with a `std::function` deleter
+// in a `std::stack`.
+
+namespace {
+
+constexpr int ITERATIONS = 1000000;
+constexpr int OBJECTS_PER_SCOPE = 8;
+
+size_t allocations = 0;
+
+// Previous registration scheme, kept here for comparison.
+namespace legacy {
+
+class ObjectFrameScope;
+
+thread_local std::stack<ObjectFrameScope *> EXCEPTION_STACK_CLEANUP;
+
+class ObjectFrameScope {
+public:
+    template <typename F>
+    explicit ObjectFrameScope(F &&deleter) : deleter_(std::move(deleter)) {
+        EXCEPTION_STACK_CLEANUP.push(this);
+    }
+
+    ~ObjectFrameScope() {
+        EXCEPTION_STACK_CLEANUP.pop();
+    }
+
+private:
+    std::function<bool()> deleter_;
+};
+
+}   // namespace legacy
+
+#define LEGACY_AUTO_OBJECT(class_name, object_name, ...)                                \
+    auto object_name = class_name(__VA_ARGS__);                                         \
+    volatile auto _OBJECT_FRAME_##class_name##object_name                               \
+        = std::make_unique<legacy::ObjectFrameScope>([obj = &object_name]() mutable {   \
+        obj->~class_name();                                                             \
+        return false;                                                                   \
+    })
+
+class Counter {
+public:
+    explicit Counter(int value) : value_(value) {}
+
+    int GetValue() const {
+        return value_;
+    }
+
+private:
+    int value_;
+};
+
+__attribute__((noinline)) int IntrusiveScope(int i) {
+    AUTO_OBJECT(Counter, c0, i);
+    AUTO_OBJECT(Counter, c1, i + 1);
+    AUTO_OBJECT(Counter, c2, i + 2);
+    AUTO_OBJECT(Counter, c3, i + 3);
+    AUTO_OBJECT(Counter, c4, i + 4);
+    AUTO_OBJECT(Counter, c5, i + 5);
+    AUTO_OBJECT(Counter, c6, i + 6);
+    AUTO_OBJECT(Counter, c7, i + 7);
+    return c0.GetValue() + c1.GetValue() + c2.GetValue() + c3.GetValue() +
+           c4.GetValue() + c5.GetValue() + c6.GetValue() + c7.GetValue();
+}
+
+__attribute__((noinline)) int LegacyScope(int i) {
+    LEGACY_AUTO_OBJECT(Counter, c0, i);
+    LEGACY_AUTO_OBJECT(Counter, c1, i + 1);
+    LEGACY_AUTO_OBJECT(Counter, c2, i + 2);
+    LEGACY_AUTO_OBJECT(Counter, c3, i + 3);
+    LEGACY_AUTO_OBJECT(Counter, c4, i + 4);
+    LEGACY_AUTO_OBJECT(Counter, c5, i + 5);
+    LEGACY_AUTO_OBJECT(Counter, c6, i + 6);
+    LEGACY_AUTO_OBJECT(Counter, c7, i + 7);
+    return c0.GetValue() + c1.GetValue() + c2.GetValue() + c3.GetValue() +
+           c4.GetValue() + c5.GetValue() + c6.GetValue() + c7.GetValue();
+}
+
+template <typename F>
+void Measure(const char *name, F &&scope) {
+    volatile int sink = 0;
+    size_t allocations_before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        sink = sink + scope(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double objects = static_cast<double>(ITERATIONS) * OBJECTS_PER_SCOPE;
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / objects;
+    double allocs = static_cast<double>(allocations - allocations_before) / objects;
+    std::printf("%12s %16.2f %16.2f\n", name, ns, allocs);
+}
+
+}   // namespace
+
+void *operator new(size_t size) {
+    ++allocations;
+    if (void *ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main() {
+    std::printf("%12s %16s %16s\n", "scheme", "ns/AUTO_OBJECT", "allocs/object");
+    Measure("legacy", LegacyScope);
+    Measure("intrusive", IntrusiveScope);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "macro_exceptions.h"
+
+// Latency of entering a protected region and of a throw caught one call up,
+// without and with a payload: TRY/THROW macros (built with the `setjmp` or with the EXCEPTIONS_FAST_JMP
+// backend) vs native C++ exceptions.
+
+namespace {
+
+constexpr int ITERATIONS = 10000000;
+
+#ifdef EXCEPTIONS_FAST_JMP
+constexpr const char *BACKEND = "macros (builtin)";
+#else
+constexpr const char *BACKEND = "macros (setjmp)";
+#endif
+
+volatile int sink = 0;
+
+struct ParseError {
+    int line;
+    int column;
+    const char *message;
+};
+
+__attribute__((noinline)) void MacroThrower(int i) {
+    if (i >= 0) {
+        THROW(exceptions::error::MATH_ERROR);
+    }
+}
+
+__attribute__((noinline)) void NativeThrower(int i) {
+    if (i >= 0) {
+        throw exceptions::error::MATH_ERROR;
+    }
+}
+
+__attribute__((noinline)) void MacroPayloadThrower(int i) {
+    if (i >= 0) {
+        THROW_WITH(exceptions::error::IO_ERROR, ParseError{i, i + 1, "unexpected token"});
+    }
+}
+
+__attribute__((noinline)) void NativePayloadThrower(int i) {
+    if (i >= 0) {
+        throw ParseError{i, i + 1, "unexpected token"};
+    }
+}
+
+__attribute__((noinline)) void MacroEntry(int i) {
+    TRY {
+        sink = sink + i;
+    } CATCH(exceptions::error::MATH_ERROR) {
+        sink = sink - 1;
+    }
+}
+
+__attribute__((noinline)) void MacroThrow(int i) {
+    TRY {
+        MacroThrower(i);
+    } CATCH(exceptions::error::MATH_ERROR) {
+        sink = sink + 1;
+    }
+}
+
+__attribute__((noinline)) void MacroPayloadThrow(int i) {
+    TRY {
+        MacroPayloadThrower(i);
+    } CATCH_AS(exceptions::error::IO_ERROR, ParseError, e) {
+        sink = sink + e.line;
+    }
+}
+
+__attribute__((noinline)) void NativeEntry(int i) {
+    try {
+        sink = sink + i;
+    } catch (exceptions::error) {
+        sink = sink - 1;
+    }
+}
+
+__attribute__((noinline)) void NativeThrow(int i) {
+    try {
+        NativeThrower(i);
+    } catch (exceptions::error) {
+        sink = sink + 1;
+    }
+}
+
+__attribute__((noinline)) void NativePayloadThrow(int i) {
+    try {
+        NativePayloadThrower(i);
+    } catch (const ParseError &e) {
+        sink = sink + e.line;
+    }
+}
+
+template <typename F>
+double MeasureNsPerOp(F &&op, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        op(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+}   // namespace
+
+int main() {
+    // Native throws are slow, fewer of them are enough.
+    constexpr int NATIVE_THROWS = ITERATIONS / 10;
+
+    std::printf("%18s %16s %16s %16s\n", "strategy", "entry_ns", "throw_catch_ns", "with_payload_ns");
+    std::printf("%18s %16.2f %16.2f %16.2f\n", BACKEND,
+                MeasureNsPerOp(MacroEntry, ITERATIONS), MeasureNsPerOp(MacroThrow, ITERATIONS),
+                MeasureNsPerOp(MacroPayloadThrow, ITERATIONS));
+    std::printf("%18s %16.2f %16.2f %16.2f\n", "C++ exceptions",
+                MeasureNsPerOp(NativeEntry, ITERATIONS), MeasureNsPerOp(NativeThrow, NATIVE_THROWS),
+                MeasureNsPerOp(NativePayloadThrow, NATIVE_THROWS));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Shared workload of the error-handling strategy benchmarks.
+// Every operation descends `DEPTH` frames, each holding `OBJECTS_PER_FRAME`
+// objects with non-trivial destructors, and the deepest frame fails with
+// the given rate. The failure is handled at the top and the operation returns -1.
+//
+// One executable per strategy, so that their binary sizes can be compared.
+
+namespace bench {
+
+constexpr int DEPTH = 8;
+constexpr int OBJECTS_PER_FRAME = 4;
+constexpr int OPS_PER_THREAD = 200000;
+// Latency percentiles are taken over batches, timing single operations
+// would mostly measure the clock.
+constexpr int BATCH = 100;
+constexpr int THROW_RATES[] = {0, 1, 10, 50};
+
+enum class Error {
+    OK = 0,
+    IO_ERROR,
+};
+
+// Spread failures evenly instead of in runs.
+inline bool ShouldFail(uint32_t i, int rate) {
+    return (i * 2654435761u) % 100 < static_cast<uint32_t>(rate);
+}
+
+inline thread_local volatile int destroyed = 0;
+
+class Resource {
+public:
+    explicit Resource(int value) : value_(value) {}
+
+    ~Resource() {
+        destroyed = destroyed + 1;
+    }
+
+    int GetValue() const {
+        return value_;
+    }
+
+private:
+    int value_;
+};
+
+struct Latency {
+    double mean_ns;
+    double p50_ns;
+    double p90_ns;
+    double p99_ns;
+};
+
+template <typename Op>
+Latency Measure(Op &op, int rate, int threads) {
+    std::vector<std::vector<double>> batches(threads);
+    std::vector<double> elapsed(threads);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            volatile int sink = 0;
+            auto &samples = batches[t];
+            samples.reserve(OPS_PER_THREAD / BATCH);
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < OPS_PER_THREAD; i += BATCH) {
+                auto batch_start = std::chrono::steady_clock::now();
+                for (uint32_t j = i; j < i + BATCH; ++j) {
+                    sink = sink + op(j, rate);
+                }
+                auto batch_end = std::chrono::steady_clock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(batch_end - batch_start).count() / BATCH);
+            }
+            elapsed[t] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    std::vector<double> samples;
+    double total_ns = 0;
+    for (int t = 0; t < threads; ++t) {
+        samples.insert(samples.end(), batches[t].begin(), batches[t].end());
+        total_ns += elapsed[t];
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        return samples[static_cast<size_t>(p * (samples.size() - 1))];
+    };
+
+    return Latency{total_ns / (static_cast<double>(threads) * OPS_PER_THREAD),
+                   percentile(0.5), percentile(0.9), percentile(0.99)};
+}
+
+inline long BinarySize() {
+    struct stat st;
+    return stat("/proc/self/exe", &st) == 0 ? static_cast<long>(st.st_size) : -1;
+}
+
+// `op(i, rate)` runs operation `i` and returns its result, -1 on failure.
+template <typename Op>
+void Run(const char *strategy, Op &&op) {
+    std::printf("strategy: %s, binary size: %ld bytes\n", strategy, BinarySize());
+    std::printf("%8s %8s %12s %12s %12s %12s\n", "threads", "fail_%", "ns/op", "p50_ns", "p90_ns", "p99_ns");
+
+    int max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (int threads : {1, max_threads}) {
+        for (int rate : THROW_RATES) {
+            auto latency = Measure(op, rate, threads);
+            std::printf("%8d %8d %12.1f %12.1f %12.1f %12.1f\n", threads, rate,
+                        latency.mean_ns, latency.p50_ns, latency.p90_ns, latency.p99_ns);
+        }
+    }
+}
+
+}   // namespace bench
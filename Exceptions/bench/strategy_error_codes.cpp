@@ -0,0 +1,48 @@
+#include <cstdlib>
+
+#include "strategy_bench.h"
+
+// Error codes returned through every frame, value via an out-parameter.
+
+namespace {
+
+using bench::Error;
+using bench::Resource;
+
+__attribute__((noinline)) Error Descend(int depth, uint32_t i, int rate, int &out) {
+    Resource r0(depth);
+    Resource r1(depth + 1);
+    Resource r2(depth + 2);
+    Resource r3(depth + 3);
+    int sum = r0.GetValue() + r1.GetValue() + r2.GetValue() + r3.GetValue();
+
+    if (depth == 0) {
+        if (bench::ShouldFail(i, rate)) {
+            return Error::IO_ERROR;
+        }
+        out = sum;
+        return Error::OK;
+    }
+
+    int deeper = 0;
+    if (Error error = Descend(depth - 1, i, rate, deeper); error != Error::OK) {
+        return error;
+    }
+    out = sum + deeper;
+    return Error::OK;
+}
+
+int Operation(uint32_t i, int rate) {
+    int result = 0;
+    if (Descend(bench::DEPTH, i, rate, result) != Error::OK) {
+        return -1;
+    }
+    return result;
+}
+
+}   // namespace
+
+int main() {
+    bench::Run("error codes", Operation);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <version>
+
+#include "strategy_bench.h"
+
+// std::expected<int, Error> returned through every frame.
+
+#if defined(__cpp_lib_expected)
+#include <expected>
+
+template <typename T, typename E>
+using Expected = std::expected<T, E>;
+
+template <typename E>
+auto Unexpected(E error) {
+    return std::unexpected<E>(error);
+}
+#else
+#include <variant>
+
+// Minimal stand-in for standard libraries without <expected>.
+template <typename E>
+struct UnexpectedValue {
+    E error;
+};
+
+template <typename E>
+UnexpectedValue<E> Unexpected(E error) {
+    return {error};
+}
+
+template <typename T, typename E>
+class Expected {
+public:
+    Expected(T value) : storage_(std::in_place_index<0>, value) {}
+    Expected(UnexpectedValue<E> error) : storage_(std::in_place_index<1>, error.error) {}
+
+    bool has_value() const {
+        return storage_.index() == 0;
+    }
+
+    T operator*() const {
+        return std::get<0>(storage_);
+    }
+
+    E error() const {
+        return std::get<1>(storage_);
+    }
+
+private:
+    std::variant<T, E> storage_;
+};
+#endif
+
+namespace {
+
+using bench::Error;
+using bench::Resource;
+
+__attribute__((noinline)) Expected<int, Error> Descend(int depth, uint32_t i, int rate) {
+    Resource r0(depth);
+    Resource r1(depth + 1);
+    Resource r2(depth + 2);
+    Resource r3(depth + 3);
+    int sum = r0.GetValue() + r1.GetValue() + r2.GetValue() + r3.GetValue();
+
+    if (depth == 0) {
+        if (bench::ShouldFail(i, rate)) {
+            return Unexpected(Error::IO_ERROR);
+        }
+        return sum;
+    }
+
+    auto deeper = Descend(depth - 1, i, rate);
+    if (!deeper.has_value()) {
+        return Unexpected(deeper.error());
+    }
+    return sum + *deeper;
+}
+
+int Operation(uint32_t i, int rate) {
+    auto result = Descend(bench::DEPTH, i, rate);
+    return result.has_value() ? *result : -1;
+}
+
+}   // namespace
+
+int main() {
+    bench::Run("std::expected", Operation);
+    return EXIT_SUCCESS;
+}
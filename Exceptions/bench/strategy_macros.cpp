@@ -0,0 +1,43 @@
+#include <cstdlib>
+
+#include "macro_exceptions.h"
+#include "strategy_bench.h"
+
+// TRY/CATCH/THROW macros, objects registered with AUTO_OBJECT.
+
+namespace {
+
+using bench::Resource;
+
+__attribute__((noinline)) int Descend(int depth, uint32_t i, int rate) {
+    AUTO_OBJECT(Resource, r0, depth);
+    AUTO_OBJECT(Resource, r1, depth + 1);
+    AUTO_OBJECT(Resource, r2, depth + 2);
+    AUTO_OBJECT(Resource, r3, depth + 3);
+    int sum = r0.GetValue() + r1.GetValue() + r2.GetValue() + r3.GetValue();
+
+    if (depth == 0) {
+        if (bench::ShouldFail(i, rate)) {
+            THROW(exceptions::error::IO_ERROR);
+        }
+        return sum;
+    }
+    return sum + Descend(depth - 1, i, rate);
+}
+
+int Operation(uint32_t i, int rate) {
+    volatile int result = -1;
+    TRY {
+        result = Descend(bench::DEPTH, i, rate);
+    } CATCH(exceptions::error::IO_ERROR) {
+        result = -1;
+    }
+    return result;
+}
+
+}   // namespace
+
+int main() {
+    bench::Run("TRY/CATCH/THROW macros", Operation);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#include <cstdlib>
+#include <exception>
+
+#include "strategy_bench.h"
+
+// Native C++ exceptions, objects destroyed by stack unwinding.
+
+namespace {
+
+using bench::Resource;
+
+struct IoError : std::exception {
+    const char *what() const noexcept override {
+        return "io error";
+    }
+};
+
+__attribute__((noinline)) int Descend(int depth, uint32_t i, int rate) {
+    Resource r0(depth);
+    Resource r1(depth + 1);
+    Resource r2(depth + 2);
+    Resource r3(depth + 3);
+    int sum = r0.GetValue() + r1.GetValue() + r2.GetValue() + r3.GetValue();
+
+    if (depth == 0) {
+        if (bench::ShouldFail(i, rate)) {
+            throw IoError();
+        }
+        return sum;
+    }
+    return sum + Descend(depth - 1, i, rate);
+}
+
+int Operation(uint32_t i, int rate) {
+    try {
+        return Descend(bench::DEPTH, i, rate);
+    } catch (const IoError &) {
+        return -1;
+    }
+}
+
+}   // namespace
+
+int main() {
+    bench::Run("C++ exceptions", Operation);
+    return EXIT_SUCCESS;
+}
@@ -5,31 +5,53 @@
 
 namespace exceptions {
 // Global objects definitions.
-std::jmp_buf ERROR_HANDLER_BUF;
+std::array<std::atomic<ExceptionHandler *>, static_cast<size_t>(error::NUM_ERRORS)> ERROR_HANDLERS {};
 
-std::array<ExceptionHandler, static_cast<size_t>(error::NUM_ERRORS)> ERROR_HANDLERS;
-
-DoubleExceptionHandler *DOUBLE_ERROR_HANDLER = nullptr;
-
-std::stack<ObjectFrameScope *> EXCEPTION_STACK_CLEANUP;
+std::atomic<DoubleExceptionHandler *> DOUBLE_ERROR_HANDLER {nullptr};
 
 void ClearStack() {
-    while (!EXCEPTION_STACK_CLEANUP.empty()) {
-        auto *top = EXCEPTION_STACK_CLEANUP.top();
+    // Records of the unwound frames are dropped without their destructors.
+    while (auto *top = EXCEPTION_STACK_CLEANUP) {
         if (top->DeleteOnException()) {
             return;
         }
-        EXCEPTION_STACK_CLEANUP.pop();
+        EXCEPTION_STACK_CLEANUP = top->Prev();
     }
 }
 
 void HandleSecondException(int first, int second) {
-    if (DOUBLE_ERROR_HANDLER) {
-        DOUBLE_ERROR_HANDLER(static_cast<error>(first), static_cast<error>(second));
+    if (auto *handler = DOUBLE_ERROR_HANDLER.load()) {
+        handler(static_cast<error>(first), static_cast<error>(second));
     } else {
         std::cerr << "Terminating after receiving an unhandled double exception: "
                   << " first " << first << ", second " << second << std::endl;
         std::abort();
     }
 }
+
+void HandleMissingPayload(int status) {
+    std::cerr << "Terminating after catching an exception without the expected payload: " << status << std::endl;
+    std::abort();
+}
+
+void Throw(int status) {
+    // A plain THROW carries no payload, stale ones must not be caught.
+    THROWN_PAYLOAD.Clear();
+    Unwind(status);
+}
+
+void Unwind(int status) {
+    if (!CURRENT_JUMP_FRAME) {
+        std::cerr << "Terminating after receiving an exception outside of TRY: " << status << std::endl;
+        std::abort();
+    }
+    // Objects of the frames being unwound are destroyed while they are still valid.
+    ClearStack();
+#ifdef EXCEPTIONS_FAST_JMP
+    CURRENT_JUMP_FRAME->status = status;
+    __builtin_longjmp(CURRENT_JUMP_FRAME->buf, 1);
+#else
+    std::longjmp(CURRENT_JUMP_FRAME->buf, status);
+#endif
+}
 }   // namespace exceptions
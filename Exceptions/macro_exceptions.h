@@ -1,13 +1,27 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <csetjmp>
-#include <functional>
-#include <stack>
+#include <cstddef>
+#include <new>
+#include <optional>
 #include <type_traits>
 #include <utility>
 
-#include <memory>
+// EXCEPTIONS_FAST_JMP: TRY/THROW use `__builtin_setjmp`/`__builtin_longjmp`,
+// which save only the frame pointer, the stack pointer and the resume address
+// (the compiler spills everything else live across TRY), instead of
+// the full callee-saved register set with pointer mangling of `setjmp`.
+#if defined(EXCEPTIONS_FAST_JMP) && !(defined(__x86_64__) && defined(__linux__) && defined(__GNUC__))
+#error "EXCEPTIONS_FAST_JMP is supported only on x86-64 Linux with GCC or Clang"
+#endif
+
+// Capacity in bytes of the per-thread buffer of THROW_WITH payloads.
+#ifndef EXCEPTIONS_PAYLOAD_SIZE
+#define EXCEPTIONS_PAYLOAD_SIZE 64
+#endif
 
 namespace exceptions {
 // Types declarations.
@@ -18,30 +32,40 @@ enum class error {
     NUM_ERRORS = MATH_ERROR,
 };
 
-using ExceptionHandler = std::function<void(error)>;
+using ExceptionHandler = void(error);
 using DoubleExceptionHandler = void(error, error);
 
 class ObjectFrameScope;
+class JumpFrame;
 
 void ClearStack();
 void HandleSecondException(int first, int second);
+[[noreturn]] void Throw(int status);
+[[noreturn]] void Unwind(int status);
+[[noreturn]] void HandleMissingPayload(int status);
 
 // Global objects declarations.
-extern std::jmp_buf ERROR_HANDLER_BUF;
-extern std::array<ExceptionHandler, static_cast<size_t>(error::NUM_ERRORS)> ERROR_HANDLERS;
-extern DoubleExceptionHandler *DOUBLE_ERROR_HANDLER;
-extern std::stack<ObjectFrameScope *> EXCEPTION_STACK_CLEANUP;
+// Handlers are shared by all threads.
+extern std::array<std::atomic<ExceptionHandler *>, static_cast<size_t>(error::NUM_ERRORS)> ERROR_HANDLERS;
+extern std::atomic<DoubleExceptionHandler *> DOUBLE_ERROR_HANDLER;
+// Exception context is per thread: innermost TRY and objects to destroy on THROW.
+// Defined inline with constant initialization, so that access needs no TLS wrapper call.
+inline thread_local JumpFrame *CURRENT_JUMP_FRAME = nullptr;
+inline thread_local ObjectFrameScope *EXCEPTION_STACK_CLEANUP = nullptr;
 
 static_assert(std::is_same_v<std::invoke_result<decltype(setjmp), std::jmp_buf>::type, int>, "");
 
+// Record in the per-thread cleanup chain, allocated on the stack of the scope
+// it protects: registration is a few pointer writes, with no allocation or
+// type erasure beyond a plain function pointer.
 class ObjectFrameScope {
 public:
-    template <typename F>
-    explicit ObjectFrameScope(F &&deleter, bool doCleanStack = false) : deleter_(std::move(deleter)) {
-        if (doCleanStack) {
-            ClearStack();
-        }
-        EXCEPTION_STACK_CLEANUP.push(this);
+    // Returns true for sentinels, which stop the cleanup.
+    using Deleter = bool(void *);
+
+    ObjectFrameScope(Deleter *deleter, void *object)
+        : prev_(EXCEPTION_STACK_CLEANUP), deleter_(deleter), object_(object) {
+        EXCEPTION_STACK_CLEANUP = this;
     }
 
     ObjectFrameScope(const ObjectFrameScope &) = delete;
@@ -50,43 +74,263 @@ public:
     ObjectFrameScope &operator=(ObjectFrameScope &&) = delete;
 
     ~ObjectFrameScope() {
-        assert(!EXCEPTION_STACK_CLEANUP.empty());
-        assert(EXCEPTION_STACK_CLEANUP.top() == this);
-        EXCEPTION_STACK_CLEANUP.pop();
+        assert(EXCEPTION_STACK_CLEANUP == this);
+        EXCEPTION_STACK_CLEANUP = prev_;
     }
 
     bool DeleteOnException() {
-        return deleter_();
+        return deleter_(object_);
+    }
+
+    ObjectFrameScope *Prev() const {
+        return prev_;
+    }
+
+private:
+    ObjectFrameScope *prev_;
+    Deleter *deleter_;
+    void *object_;
+};
+
+template <typename T>
+bool DestroyObject(void *object) {
+    static_cast<T *>(object)->~T();
+    return false;
+}
+
+inline bool StopCleanup(void *) {
+    return true;
+}
+
+// Link in the per-thread chain of TRY blocks, THROW jumps to the innermost one.
+class JumpFrame {
+public:
+    JumpFrame() : prev_(CURRENT_JUMP_FRAME) {
+        CURRENT_JUMP_FRAME = this;
+    }
+
+    JumpFrame(const JumpFrame &) = delete;
+    JumpFrame &operator=(const JumpFrame &) = delete;
+    JumpFrame(JumpFrame &&) = delete;
+    JumpFrame &operator=(JumpFrame &&) = delete;
+
+    ~JumpFrame() {
+        assert(CURRENT_JUMP_FRAME == this);
+        CURRENT_JUMP_FRAME = prev_;
+    }
+
+    JumpFrame *Prev() const {
+        return prev_;
+    }
+
+#ifdef EXCEPTIONS_FAST_JMP
+    void *buf[5];
+    // `__builtin_longjmp` can only pass 1, the status goes through the frame.
+    int status {0};
+#else
+    std::jmp_buf buf;
+#endif
+
+private:
+    JumpFrame *prev_;
+};
+
+// Scope of a TRY block (or of a CATCH body): stops the cleanup of AUTO_OBJECTs
+// declared outside of it and receives THROWs from inside of it.
+class TryScope {
+public:
+    TryScope() : sentinel_(&StopCleanup, nullptr) {}
+
+#ifdef EXCEPTIONS_FAST_JMP
+    void **Buffer() {
+        return frame_.buf;
+    }
+
+    int Status() const {
+        return frame_.status;
+    }
+#else
+    std::jmp_buf &Buffer() {
+        return frame_.buf;
+    }
+#endif
+
+    // Leaves the scope for good and passes `status` to the enclosing TRY.
+    // The destructor never runs: the frame is unlinked here.
+    [[noreturn]] void Rethrow(int status) {
+        EXCEPTION_STACK_CLEANUP = sentinel_.Prev();
+        CURRENT_JUMP_FRAME = frame_.Prev();
+        Unwind(status);
+    }
+
+private:
+    ObjectFrameScope sentinel_;
+    JumpFrame frame_;
+};
+
+// Lives for a whole TRY statement, its CATCHes included, and so does the
+// scope of its block: a status that none of them caught goes on to the
+// enclosing TRY, with its payload, once the statement ends.
+class CatchChain {
+public:
+    CatchChain() = default;
+
+    CatchChain(const CatchChain &) = delete;
+    CatchChain &operator=(const CatchChain &) = delete;
+
+    ~CatchChain() {
+        if (status != 0 && !body_) {
+            scope_.Rethrow(status);
+        }
+    }
+
+    TryScope &Scope() {
+        return scope_;
+    }
+
+    bool Matches(int error_status) const {
+        return status == error_status && !body_;
+    }
+
+    // True for the first CATCH to match only, which gets a scope for its body.
+    bool Catch(int error_status) {
+        if (!Matches(error_status)) {
+            return false;
+        }
+        body_.emplace();
+        return true;
+    }
+
+    // A THROW from the body of the CATCH is a second exception.
+    TryScope &Body() {
+        return *body_;
     }
 
+    // Status the block was left with, 0 while it runs.
+    int status {0};
+    // Status of the second exception.
+    int second {0};
+
 private:
-    std::function<bool()> deleter_;
+    TryScope scope_;
+    std::optional<TryScope> body_;
 };
 
+// Storage of THROW_WITH payloads: constructed in place, so throwing one needs
+// no allocation. A payload lives until the next throw on the same thread.
+// Payloads are trivially destructible, they are overwritten and dropped
+// without running any destructor, as unwound frames are.
+class PayloadBuffer {
+public:
+    static constexpr size_t SIZE = EXCEPTIONS_PAYLOAD_SIZE;
+    static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+    template <typename T>
+    void Store(T &&payload) {
+        using Payload = std::decay_t<T>;
+        static_assert(sizeof(Payload) <= SIZE, "THROW_WITH payload exceeds EXCEPTIONS_PAYLOAD_SIZE");
+        static_assert(alignof(Payload) <= ALIGNMENT, "THROW_WITH payload is over-aligned");
+        static_assert(std::is_trivially_destructible_v<Payload>, "THROW_WITH payload must be trivially destructible");
+        new (storage_) Payload(std::forward<T>(payload));
+        type_ = &TypeTag<Payload>::ID;
+    }
+
+    // Returns nullptr unless the payload is of type T.
+    template <typename T>
+    T *Get() {
+        return type_ == &TypeTag<T>::ID ? std::launder(reinterpret_cast<T *>(storage_)) : nullptr;
+    }
+
+    void Clear() {
+        type_ = nullptr;
+    }
+
+    // Storage seen as a T, for references that are never used.
+    template <typename T>
+    T &Unused() {
+        static_assert(sizeof(T) <= SIZE && alignof(T) <= ALIGNMENT, "CATCH_AS payload cannot be thrown");
+        return *reinterpret_cast<T *>(storage_);
+    }
+
+private:
+    // Identifies payload types without RTTI: one distinct address per type.
+    template <typename T>
+    struct TypeTag {
+        static constexpr char ID = 0;
+    };
+
+    alignas(ALIGNMENT) unsigned char storage_[SIZE] {};
+    const void *type_ {nullptr};
+};
+
+// Payload of the last THROW on this thread.
+inline thread_local PayloadBuffer THROWN_PAYLOAD;
+
+template <typename T>
+[[noreturn]] void ThrowWith(int status, T payload) {
+    // `payload` is a copy: it may refer to objects about to be destroyed,
+    // or to the payload being handled.
+    THROWN_PAYLOAD.Store(std::move(payload));
+    Unwind(status);
+}
+
+// Payload of the THROW being handled, of type T or nullptr.
+template <typename T>
+T *GetPayload() {
+    return THROWN_PAYLOAD.Get<T>();
+}
+
+template <typename T>
+T &CaughtPayload(int status) {
+    if (T *payload = THROWN_PAYLOAD.Get<T>()) {
+        return *payload;
+    }
+    HandleMissingPayload(status);
+}
+
+// Payload for a CATCH_AS of `error_status`, the CATCHes that do not match
+// leave it unused.
+template <typename T>
+T &CatchPayload(const CatchChain &chain, int error_status) {
+    return chain.Matches(error_status) ? CaughtPayload<T>(error_status) : THROWN_PAYLOAD.Unused<T>();
+}
+
 }   // namespace exceptions
 
 // Macros definitions.
-#define TRY                                                             \
-    exceptions::ObjectFrameScope _TRY_SENTINEL([](){ return true; });   \
-    int _SETJMP_RESULT = 0;                                             \
-    if ((_SETJMP_RESULT = setjmp(exceptions::ERROR_HANDLER_BUF)) == 0)
-
-#define CATCH(error_status)                                                                                                     \
-    else if (_SETJMP_RESULT == static_cast<int>(error_status))                                                                  \
-        if (volatile auto _TRY_SECOND_SENTINEL = std::make_unique<exceptions::ObjectFrameScope>([](){ return true; }, true);    \
-            (_SETJMP_RESULT = setjmp(exceptions::ERROR_HANDLER_BUF)) != 0) {                                                    \
-            exceptions::HandleSecondException(static_cast<int>(error_status), _SETJMP_RESULT);                                  \
-        } else
-
-#define THROW(status) std::longjmp(exceptions::ERROR_HANDLER_BUF, static_cast<int>(status))
-
-#define SET_UNEXPECTED_HANDLER(handler) exceptions::DOUBLE_ERROR_HANDLER = handler
-
-#define AUTO_OBJECT(class_name, object_name, ...)                                           \
-    auto object_name = class_name(__VA_ARGS__);                                             \
-    volatile auto _OBJECT_FRAME_##class_name##object_name                                   \
-        = std::make_unique<exceptions::ObjectFrameScope>([obj = &object_name]() mutable {   \
-        static_assert(std::is_same_v<decltype(obj), class_name *>, "");                     \
-        obj->~class_name();                                                                 \
-        return false;                                                                       \
-    })
+#ifdef EXCEPTIONS_FAST_JMP
+#define _EXCEPTIONS_SETJMP(scope) (__builtin_setjmp((scope).Buffer()) == 0 ? 0 : (scope).Status())
+#else
+#define _EXCEPTIONS_SETJMP(scope) setjmp((scope).Buffer())
+#endif
+
+// The whole TRY is one statement: its frame is unlinked once the statement ends.
+#define TRY                                                                             \
+    if (exceptions::CatchChain _TRY_CHAIN; false) {                                     \
+    } else if ((_TRY_CHAIN.status = _EXCEPTIONS_SETJMP(_TRY_CHAIN.Scope())) == 0)
+
+// Each CATCH is a single `if`, so that its body and the next CATCH bind unambiguously.
+#define _EXCEPTIONS_CATCH(error_status)                                                                 \
+    _TRY_CHAIN.Catch(static_cast<int>(error_status)) &&                                                 \
+        ((_TRY_CHAIN.second = _EXCEPTIONS_SETJMP(_TRY_CHAIN.Body())) == 0 ||                            \
+         (exceptions::HandleSecondException(static_cast<int>(error_status), _TRY_CHAIN.second), false))
+
+#define CATCH(error_status) else if (_EXCEPTIONS_CATCH(error_status))
+
+// Payloads are caught with CATCH_AS, or with `exceptions::GetPayload<T>()` in a CATCH.
+#define CATCH_AS(error_status, type, var)                                                              \
+    else if (type &var = exceptions::CatchPayload<type>(_TRY_CHAIN, static_cast<int>(error_status));   \
+             _EXCEPTIONS_CATCH(error_status))
+
+#define THROW(status) exceptions::Throw(static_cast<int>(status))
+
+// Variadic so that braced initializers with commas can be passed.
+#define THROW_WITH(status, ...) exceptions::ThrowWith(static_cast<int>(status), __VA_ARGS__)
+
+#define SET_UNEXPECTED_HANDLER(handler) exceptions::DOUBLE_ERROR_HANDLER.store(handler)
+
+#define AUTO_OBJECT(class_name, object_name, ...)                                    \
+    auto object_name = class_name(__VA_ARGS__);                                      \
+    static_assert(std::is_same_v<decltype(object_name), class_name>, "");            \
+    exceptions::ObjectFrameScope _OBJECT_FRAME_##class_name##object_name(            \
+        &exceptions::DestroyObject<class_name>, &object_name)
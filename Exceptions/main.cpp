@@ -1,8 +1,11 @@
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "macro_exceptions.h"
 
-void crash(exceptions::error first, exceptions::error second) {
+void crash([[maybe_unused]] exceptions::error first, [[maybe_unused]] exceptions::error second) {
     std::cerr << "Second exception thrown" << std::endl;
 }
 
@@ -14,6 +17,16 @@ int divide(int num, int denum) {
 	return num / denum;
 }
 
+// Контекст ошибки передаётся вместе с исключением
+struct ReadError {
+    int code;
+    long offset;
+};
+
+void read(long offset) {
+    THROW_WITH(exceptions::error::IO_ERROR, ReadError{5, offset});
+}
+
 class CMyClass {
 public:
     explicit CMyClass(int value) : value_(value) {}
@@ -37,10 +50,92 @@ int auxiliary() {
 	return z;
 }
 
+// Вложенные TRY: внутренний ловит только свои исключения, остальные
+// уходят во внешний
+bool nested() {
+	volatile int catched = 0;
+	TRY {
+		TRY {
+			divide(1, 0);
+		} CATCH(exceptions::error::MATH_ERROR) {
+			std::cerr << "Inner TRY catched MATH_ERROR" << std::endl;
+			++catched;
+		}
+		{
+			AUTO_OBJECT(CMyClass, innerObject, 2);
+			TRY {
+				read(innerObject.GetValue());
+			} CATCH(exceptions::error::MATH_ERROR) {
+				std::cerr << "Inner TRY must not catch IO_ERROR" << std::endl;
+				return false;
+			}
+			std::cerr << "IO_ERROR must leave the block" << std::endl;
+			return false;
+		}
+	} CATCH_AS(exceptions::error::IO_ERROR, ReadError, e) {
+		std::cerr << "Outer TRY catched IO_ERROR at offset " << e.offset << std::endl;
+		++catched;
+	}
+
+	// Закончившийся TRY больше не ловит исключения своего блока
+	TRY {
+		TRY {
+			divide(1, 1);
+		} CATCH(exceptions::error::MATH_ERROR) {
+			std::cerr << "Finished TRY must not catch MATH_ERROR" << std::endl;
+			return false;
+		}
+		divide(1, 0);
+	} CATCH(exceptions::error::MATH_ERROR) {
+		std::cerr << "Outer TRY catched MATH_ERROR after the inner one" << std::endl;
+		++catched;
+	}
+	return catched == 3;
+}
+
+// У каждого потока свой контекст исключений и свой payload
+bool threads() {
+	constexpr int THREADS = 4;
+	constexpr int ITERATIONS = 10000;
+
+	std::atomic<int> catched {0};
+	std::vector<std::thread> workers;
+	for (int thread = 0; thread < THREADS; ++thread) {
+		workers.emplace_back([thread, &catched] {
+			for (int i = 0; i < ITERATIONS; ++i) {
+				TRY {
+					read(thread);
+				} CATCH_AS(exceptions::error::IO_ERROR, ReadError, e) {
+					if (e.offset == thread) {
+						catched.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}
+		});
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	std::cerr << "Threads catched " << catched.load() << " of " << THREADS * ITERATIONS << std::endl;
+	return catched.load() == THREADS * ITERATIONS;
+}
+
 int main() {
     // Регистрация обработчика повторного исключения
 	SET_UNEXPECTED_HANDLER(crash);
 
+	if (!nested() || !threads()) {
+		return EXIT_FAILURE;
+	}
+
+	{
+		TRY {
+			read(42);
+		} CATCH_AS(exceptions::error::IO_ERROR, ReadError, e) {
+			std::cerr << "Catched IO_ERROR " << e.code << " at offset " << e.offset << std::endl;
+		}
+	}
+
 	TRY {
 		// Эта функция бросит исключение
 		int z = auxiliary();
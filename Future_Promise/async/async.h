@@ -1,8 +1,15 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
 #include <functional>
+#include <limits>
+#include <source_location>
 #include <type_traits>
 
+#include "exec/executor.h"
 #include "exec/thread_pool.h"
 #include "async/future.h"
 #include "async/promise.h"
@@ -17,46 +24,226 @@ template <class F, class... Args>
 using ResultT = std::result_of<typename std::decay<F>::type(
     typename std::decay<Args>::type...)>::type;
 
+// Running average of the execution time of a callable at one call site.
+struct CostEstimate {
+    // Tasks cheaper than this are not worth an enqueue and a worker wake-up.
+    static constexpr uint64_t INLINE_THRESHOLD_NS = 10000;
+    static constexpr uint64_t UNKNOWN = std::numeric_limits<uint64_t>::max();
+
+    bool IsCheap() const {
+        auto ns = average_ns.load(std::memory_order_relaxed);
+        return ns != UNKNOWN && ns < INLINE_THRESHOLD_NS;
+    }
+
+    void Update(uint64_t sample_ns) {
+        // Exponential moving average with 1/8 weight of a new sample,
+        // races between updates only lose samples.
+        auto ns = average_ns.load(std::memory_order_relaxed);
+        auto updated = (ns == UNKNOWN) ? sample_ns : ns - ns / 8 + sample_ns / 8;
+        average_ns.store(updated, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> average_ns {UNKNOWN};
+};
+
+// Estimates of a callable type, one per call site: the same function
+// pointer may be cheap at one site and expensive at another.
+// Looked up on every adaptive launch, so without a lock: a site claims a
+// slot once, later calls only load its key.
+class CostEstimates {
+public:
+    static constexpr size_t SLOTS = 32;
+
+    CostEstimate &At(const std::source_location &site) {
+        uint64_t key = Key(site);
+        for (size_t i = 0; i < SLOTS; ++i) {
+            Slot &slot = slots_[(key + i) % SLOTS];
+            uint64_t current = slot.key.load(std::memory_order_acquire);
+            if (current == EMPTY && slot.key.compare_exchange_strong(current, key)) {
+                return slot.estimate;
+            }
+            if (current == key) {
+                return slot.estimate;
+            }
+        }
+        // More sites than slots, the rest share an estimate.
+        return overflow_;
+    }
+
+private:
+    static constexpr uint64_t EMPTY = 0;
+
+    // Sites whose keys collide share an estimate.
+    static uint64_t Key(const std::source_location &site) {
+        constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
+        auto key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(site.file_name()));
+        key = (key ^ site.line()) * MULTIPLIER;
+        key = (key ^ site.column()) * MULTIPLIER;
+        return (key >> 32) | 1;
+    }
+
+    struct Slot {
+        std::atomic<uint64_t> key {EMPTY};
+        CostEstimate estimate;
+    };
+
+    std::array<Slot, SLOTS> slots_;
+    CostEstimate overflow_;
+};
+
+template <class F>
+inline CostEstimates _cost_estimates;
+
+// True for one cheap task in 64 at random, the others run untimed: reading
+// the clock twice costs as much as they do. Random, so that launches from
+// several sites in a fixed pattern are all sampled.
+inline bool SampleCheap() {
+    thread_local uint64_t state = 0x853c49e6748fea9b;
+    state = state * 6364136223846793005 + 1442695040888963407;
+    return (state >> 58) == 0;
+}
+
+// Wraps `func` so that every call updates `estimate`.
+template <class F>
+auto Measured(CostEstimate &estimate, F &&func) {
+    return [&estimate, func = std::forward<F>(func)](auto&&... args) mutable {
+        struct Timer {
+            ~Timer() {
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                estimate.Update(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            }
+
+            CostEstimate &estimate;
+            std::chrono::steady_clock::time_point start;
+        } timer {estimate, std::chrono::steady_clock::now()};
+
+        return std::invoke(std::move(func), std::forward<decltype(args)>(args)...);
+    };
+}
+
+template <class T, class F, class... Args>
+void Fulfill(Promise<T> &p, F &func, Args&... args) {
+    try {
+        std::move(p).SetValue(std::invoke(std::move(func), std::move(args)...));
+    } catch(...) {
+        std::move(p).SetException(std::current_exception());
+    }
+}
+
+template <class F, class... Args>
+Future<ResultT<F, Args...>> RunInline(F &&func, Args&&... args) {
+    using T = ResultT<F, Args...>;
+
+    try {
+        return Future<T>::MakeReady(std::invoke(std::forward<F>(func), std::forward<Args>(args)...));
+    } catch(...) {
+        return Future<T>::MakeException(std::current_exception());
+    }
+}
+
+template <class F, class... Args>
+Future<ResultT<F, Args...>> Submit(exec::IExecutor &executor, F &&func, Args&&... args) {
+    using T = ResultT<F, Args...>;
+
+    Promise<T> p;
+    auto f = p.MakeFuture();
+    executor.Submit([&executor,
+                     p = std::move(p),
+                     func = std::forward<F>(func),
+                     ... args = std::forward<Args>(args)]() mutable {
+        p.SetExecutor(&executor);
+        Fulfill(p, func, args...);
+    });
+    return f;
+}
+
+// Runs in the global pool unless asked to run inline or the pool is busy.
+template <class F, class... Args>
+Future<ResultT<F, Args...>> Dispatch(bool run_inline, F &&func, Args&&... args) {
+    if (!run_inline) {
+        _async_pool.Start();
+        run_inline = !_async_pool.HasFreeWorkers();
+    }
+
+    if (run_inline) {
+        return RunInline(std::forward<F>(func), std::forward<Args>(args)...);
+    }
+    return Submit(_async_pool, std::forward<F>(func), std::forward<Args>(args)...);
+}
+
+template <class F, class... Args>
+Future<ResultT<F, Args...>> Defer(F &&func, Args&&... args) {
+    using T = ResultT<F, Args...>;
+
+    Promise<T> p;
+    auto f = p.MakeFuture();
+    f.SetDeferred([p = std::move(p),
+                   func = std::forward<F>(func),
+                   ... args = std::forward<Args>(args)]() mutable {
+        Fulfill(p, func, args...);
+    });
+    return f;
+}
+
 }   // namespace _detail
 
 enum class Launch {
+    // Run in the global pool, inline if it has no free workers.
     async,
+    // Run inline.
     sync,
+    // Run in the context of the first `Get`/`Then` on the returned future.
+    deferred,
+    // Run inline if this callable used to be cheaper than an enqueue at
+    // this call site, in the global pool otherwise.
+    adaptive,
+};
+
+// A launch policy and the place of the `Async` call, which keys the cost
+// estimate of Launch::adaptive. Converted implicitly from Launch, so the
+// default argument is evaluated where `Async` is called.
+struct LaunchSite {
+    LaunchSite(Launch launch, std::source_location location = std::source_location::current())
+        : launch(launch), location(location) {
+    }
+
+    Launch launch;
+    std::source_location location;
 };
 
 template <class F, class... Args>
 Future<_detail::ResultT<F, Args...>>
-Async(Launch policy, F &&func, Args&&... args) {
-    using T = _detail::ResultT<F, Args...>;
-
-    if (policy == Launch::async) {
-        _detail::_async_pool.Start();
+Async(LaunchSite site, F &&func, Args&&... args) {
+    Launch policy = site.launch;
+    if (policy == Launch::deferred) {
+        return _detail::Defer(std::forward<F>(func), std::forward<Args>(args)...);
     }
 
-    if (policy == Launch::sync || !_detail::_async_pool.HasFreeWorkers()) {
-        try {
-            return Future<T>::MakeReady(std::invoke(std::forward<F>(func), std::forward<Args>(args)...));
-        } catch(...) {
-            return Future<T>::MakeException(std::current_exception());
+    if (policy == Launch::adaptive) {
+        auto &estimate = _detail::_cost_estimates<std::decay_t<F>>.At(site.location);
+        bool cheap = estimate.IsCheap();
+        if (cheap && !_detail::SampleCheap()) {
+            return _detail::RunInline(std::forward<F>(func), std::forward<Args>(args)...);
         }
+        return _detail::Dispatch(cheap,
+                                 _detail::Measured(estimate, std::forward<F>(func)),
+                                 std::forward<Args>(args)...);
     }
 
-    Promise<T> p;
-    auto f = p.MakeFuture();
-    _detail::_async_pool.Submit([p = std::move(p),
-                                func = std::forward<F>(func),
-                                ... args = std::forward<Args>(args)]() mutable {
-        p.SetExecutor(exec::ThreadPool::Current());
-        try {
-            std::move(p).SetValue(std::invoke(std::move(func), std::move(args)...));
-        } catch(...) {
-            std::move(p).SetException(std::current_exception());
-        }
-    });
-    return f;
+    return _detail::Dispatch(policy == Launch::sync, std::forward<F>(func), std::forward<Args>(args)...);
+}
+
+// Run in `executor`, continuations of the returned future are scheduled there too.
+template <class F, class... Args>
+Future<_detail::ResultT<F, Args...>>
+Async(exec::IExecutor &executor, F &&func, Args&&... args) {
+    return _detail::Submit(executor, std::forward<F>(func), std::forward<Args>(args)...);
 }
 
 template <class F, class... Args>
+requires (!std::derived_from<std::remove_cvref_t<F>, exec::IExecutor> &&
+          !std::same_as<std::remove_cvref_t<F>, Launch> &&
+          !std::same_as<std::remove_cvref_t<F>, LaunchSite>)
 Future<typename std::result_of<typename std::decay<F>::type(
         typename std::decay<Args>::type...)>::type>
 Async(F &&func, Args&&... args) {
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "async/async.h"
+#include "async/future.h"
+#include "async/promise.h"
+
+namespace async {
+
+// Memoization of asynchronous computations with request coalescing:
+// concurrent misses for a key start exactly one computation, and every caller
+// gets a future for its result.
+//
+// Sharded map, each shard under its own mutex. Values are copied out to callers.
+// Failed computations are not cached. Computations in flight are never evicted.
+//
+// Eviction is CLOCK (second chance) per shard: an entry used since the hand
+// last passed it survives one more round.
+// Expired entries are dropped on lookup, and by a timer every `purge_period`
+// if it is set.
+//
+// Must outlive its computations, the destructor waits for them.
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class AsyncCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr Clock::duration NO_TTL = Clock::duration::max();
+    static constexpr size_t SHARDS = 16;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        // Requests attached to a computation in flight.
+        uint64_t coalesced;
+        uint64_t evictions;
+        uint64_t expirations;
+    };
+
+public:
+    explicit AsyncCache(size_t capacity, Clock::duration ttl = NO_TTL,
+                        Clock::duration purge_period = Clock::duration::zero())
+            : shard_capacity_((capacity + SHARDS - 1) / SHARDS), ttl_(ttl) {
+        assert(capacity > 0);
+        if (purge_period > Clock::duration::zero()) {
+            purger_ = std::thread([this, purge_period]() {
+                std::unique_lock lg{purger_mutex_};
+                while (!purger_cv_.wait_for(lg, purge_period, [this]() { return stopped_; })) {
+                    lg.unlock();
+                    PurgeExpired();
+                    lg.lock();
+                }
+            });
+        }
+    }
+
+    // Non-copyable
+    AsyncCache(const AsyncCache&) = delete;
+    AsyncCache& operator=(const AsyncCache&) = delete;
+
+    // Non-movable
+    AsyncCache(AsyncCache&&) = delete;
+    AsyncCache& operator=(AsyncCache&&) = delete;
+
+    ~AsyncCache() {
+        if (purger_.joinable()) {
+            {
+                std::lock_guard lg{purger_mutex_};
+                stopped_ = true;
+            }
+            purger_cv_.notify_one();
+            purger_.join();
+        }
+        while (computing_.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // `compute` returns either Future<V>, or V and is then run with `Async`.
+    // It is called only on a miss.
+    template <typename F>
+    Future<V> GetOrCompute(const K &key, F &&compute) {
+        Shard &shard = ShardFor(key);
+        std::unique_lock lg{shard.mutex};
+
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            Entry &entry = it->second;
+            entry.referenced = true;
+            if (!entry.value) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return Wait(entry);
+            }
+            if (Clock::now() < entry.expires_at) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return Future<V>::MakeReady(V(entry.value.value()));
+            }
+            expirations_.fetch_add(1, std::memory_order_relaxed);
+            Erase(shard, it);
+        }
+
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        auto f = Wait(Insert(shard, key));
+        lg.unlock();
+
+        Start(key, std::forward<F>(compute));
+        return f;
+    }
+
+    // A computation in flight still completes its waiters, its result is not cached.
+    void Invalidate(const K &key) {
+        Shard &shard = ShardFor(key);
+        std::lock_guard lg{shard.mutex};
+
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            return;
+        }
+        if (it->second.value) {
+            Erase(shard, it);
+        } else {
+            it->second.invalidated = true;
+        }
+    }
+
+    // Returns the number of dropped entries.
+    size_t PurgeExpired() {
+        size_t purged = 0;
+        auto now = Clock::now();
+        for (Shard &shard : shards_) {
+            std::lock_guard lg{shard.mutex};
+            for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+                auto next = std::next(it);
+                if (it->second.value && it->second.expires_at <= now) {
+                    Erase(shard, it);
+                    ++purged;
+                }
+                it = next;
+            }
+        }
+        expirations_.fetch_add(purged, std::memory_order_relaxed);
+        return purged;
+    }
+
+    // Including computations in flight.
+    size_t Size() {
+        size_t size = 0;
+        for (Shard &shard : shards_) {
+            std::lock_guard lg{shard.mutex};
+            size += shard.entries.size();
+        }
+        return size;
+    }
+
+    Stats GetStats() const {
+        return Stats{
+            hits_.load(std::memory_order_relaxed),
+            misses_.load(std::memory_order_relaxed),
+            coalesced_.load(std::memory_order_relaxed),
+            evictions_.load(std::memory_order_relaxed),
+            expirations_.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+    struct Entry {
+        // Position in the CLOCK ring.
+        size_t slot {0};
+        bool referenced {false};
+        bool invalidated {false};
+        // Empty while the computation is in flight.
+        std::optional<V> value {};
+        Clock::time_point expires_at {};
+        std::vector<Promise<V>> waiters {};
+    };
+
+    using Entries = std::unordered_map<K, Entry, Hash>;
+
+    struct Shard {
+        std::mutex mutex;
+        Entries entries;
+        // CLOCK ring of keys, empty slots are in `free_slots`.
+        std::vector<std::optional<K>> ring;
+        std::vector<size_t> free_slots;
+        size_t hand {0};
+    };
+
+private:
+    Shard &ShardFor(const K &key) {
+        // std::hash of integers is the identity, mix the bits before taking a shard.
+        auto hash = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+        return shards_[(hash >> 32) % SHARDS];
+    }
+
+    static Future<V> Wait(Entry &entry) {
+        Promise<V> p;
+        auto f = p.MakeFuture();
+        entry.waiters.push_back(std::move(p));
+        return f;
+    }
+
+    Entry &Insert(Shard &shard, const K &key) {
+        size_t slot;
+        if (!shard.free_slots.empty()) {
+            slot = shard.free_slots.back();
+            shard.free_slots.pop_back();
+        } else if (shard.ring.size() < shard_capacity_) {
+            slot = shard.ring.size();
+            shard.ring.emplace_back();
+        } else {
+            slot = Evict(shard);
+        }
+
+        shard.ring[slot] = key;
+        Entry &entry = shard.entries[key];
+        entry.slot = slot;
+        return entry;
+    }
+
+    // Returns a slot freed by the CLOCK hand.
+    size_t Evict(Shard &shard) {
+        // Two rounds clear all reference bits, unless everything is in flight.
+        for (size_t step = 0; step < 2 * shard.ring.size(); ++step) {
+            size_t slot = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.ring.size();
+
+            auto it = shard.entries.find(shard.ring[slot].value());
+            Entry &entry = it->second;
+            if (!entry.value) {
+                continue;
+            }
+            if (entry.referenced) {
+                entry.referenced = false;
+                continue;
+            }
+
+            shard.entries.erase(it);
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+            return slot;
+        }
+
+        // Over capacity until some computations complete.
+        shard.ring.emplace_back();
+        return shard.ring.size() - 1;
+    }
+
+    void Erase(Shard &shard, typename Entries::iterator it) {
+        size_t slot = it->second.slot;
+        shard.ring[slot].reset();
+        shard.free_slots.push_back(slot);
+        shard.entries.erase(it);
+    }
+
+    template <typename F>
+    void Start(const K &key, F &&compute) {
+        computing_.fetch_add(1);
+
+        Future<V> computation = [&]() {
+            try {
+                if constexpr (_detail::FutureType<std::invoke_result_t<F>>) {
+                    return std::invoke(std::forward<F>(compute));
+                } else {
+                    return Async(std::forward<F>(compute));
+                }
+            } catch(...) {
+                return Future<V>::MakeException(std::current_exception());
+            }
+        }();
+
+        computation.Then([this, key](_detail::SharedState<V> &state) {
+            Complete(key, state);
+            // Last access to the cache.
+            computing_.fetch_sub(1);
+        });
+    }
+
+    void Complete(const K &key, _detail::SharedState<V> &state) {
+        std::vector<Promise<V>> waiters;
+        {
+            Shard &shard = ShardFor(key);
+            std::lock_guard lg{shard.mutex};
+
+            auto it = shard.entries.find(key);
+            assert(it != shard.entries.end() && !it->second.value);
+            waiters = std::move(it->second.waiters);
+
+            if (state.exception || it->second.invalidated) {
+                Erase(shard, it);
+            } else {
+                it->second.value = state.result.value();
+                it->second.expires_at = (ttl_ == NO_TTL) ? Clock::time_point::max() : Clock::now() + ttl_;
+            }
+        }
+
+        // Outside of the lock: continuations of waiters may use the cache.
+        for (auto &p : waiters) {
+            if (state.exception) {
+                std::move(p).SetException(state.exception);
+            } else {
+                std::move(p).SetValue(V(state.result.value()));
+            }
+        }
+    }
+
+private:
+    const size_t shard_capacity_;
+    const Clock::duration ttl_;
+
+    std::array<Shard, SHARDS> shards_;
+
+    std::atomic<size_t> computing_ {0};
+
+    std::atomic<uint64_t> hits_ {0};
+    std::atomic<uint64_t> misses_ {0};
+    std::atomic<uint64_t> coalesced_ {0};
+    std::atomic<uint64_t> evictions_ {0};
+    std::atomic<uint64_t> expirations_ {0};
+
+    std::thread purger_;
+    std::mutex purger_mutex_;
+    std::condition_variable purger_cv_;
+    bool stopped_ {false};
+};
+
+}   // namespace async
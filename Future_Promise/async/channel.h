@@ -0,0 +1,176 @@
+#pragma once
+
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+#include "async/future.h"
+#include "async/promise.h"
+#include "async/unit.h"
+#include "exec/executor.h"
+
+namespace async {
+
+// Multi-producer/multi-consumer channel for pipelined stages.
+// Neither side blocks a thread: `Send` and `Recv` return futures, and a stage
+// continues with `Then` once there is capacity or a value.
+//
+// When the other side is ready (a value is buffered for `Recv`, there is
+// capacity or a waiting receiver for `Send`) the returned future is already
+// fulfilled and no promise is created.
+
+template <typename T>
+class Channel {
+public:
+    static constexpr size_t UNBOUNDED = std::numeric_limits<size_t>::max();
+
+public:
+    // Waiters are woken in `executor` if it is set, inline otherwise.
+    explicit Channel(size_t capacity = UNBOUNDED, exec::IExecutor *executor = nullptr)
+            : capacity_(capacity), executor_(executor) {
+        assert(capacity_ > 0);
+    }
+
+    // Non-copyable
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    // Non-movable
+    Channel(Channel&&) = delete;
+    Channel& operator=(Channel&&) = delete;
+
+    ~Channel() noexcept = default;
+
+    // Resolved once `value` is buffered or handed to a receiver,
+    // with exception if the channel is closed.
+    Future<Unit> Send(T value) {
+        std::unique_lock lg{mutex_};
+
+        if (closed_) {
+            return MakeClosedError();
+        }
+
+        if (!receivers_.empty()) {
+            auto receiver = std::move(receivers_.front());
+            receivers_.pop_front();
+            lg.unlock();
+
+            Wake(std::move(receiver), std::optional<T>{std::move(value)});
+            return Ready(Unit{});
+        }
+
+        if (buffer_.size() < capacity_) {
+            buffer_.push_back(std::move(value));
+            return Ready(Unit{});
+        }
+
+        // Backpressure: wait until a receiver frees a slot.
+        Promise<Unit> p;
+        auto f = p.MakeFuture();
+        f.SetExecutor(executor_);
+        senders_.push_back(PendingSend{std::move(value), std::move(p)});
+        return f;
+    }
+
+    // Resolved with the next value, or with `std::nullopt` once the channel is closed and drained.
+    Future<std::optional<T>> Recv() {
+        std::unique_lock lg{mutex_};
+
+        if (!buffer_.empty()) {
+            auto value = std::move(buffer_.front());
+            buffer_.pop_front();
+
+            // Slot is freed, admit the oldest waiting sender.
+            if (!senders_.empty()) {
+                auto sender = std::move(senders_.front());
+                senders_.pop_front();
+                buffer_.push_back(std::move(sender.value));
+                lg.unlock();
+
+                Wake(std::move(sender.promise), Unit{});
+            }
+            return Ready(std::optional<T>{std::move(value)});
+        }
+
+        if (closed_) {
+            return Ready(std::optional<T>{});
+        }
+
+        Promise<std::optional<T>> p;
+        auto f = p.MakeFuture();
+        f.SetExecutor(executor_);
+        receivers_.push_back(std::move(p));
+        return f;
+    }
+
+    // Waiting receivers get `std::nullopt`, waiting senders get exception.
+    // Buffered values can still be received.
+    void Close() {
+        std::deque<PendingSend> senders;
+        std::deque<Promise<std::optional<T>>> receivers;
+        {
+            std::lock_guard lg{mutex_};
+            closed_ = true;
+            senders.swap(senders_);
+            receivers.swap(receivers_);
+        }
+
+        for (auto &sender : senders) {
+            std::move(sender.promise).SetException(ClosedError());
+        }
+        for (auto &receiver : receivers) {
+            Wake(std::move(receiver), std::optional<T>{});
+        }
+    }
+
+private:
+    struct PendingSend {
+        T value;
+        Promise<Unit> promise;
+    };
+
+    template <typename U>
+    Future<U> Ready(U &&value) {
+        auto f = Future<U>::MakeReady(std::move(value));
+        f.SetExecutor(executor_);
+        return f;
+    }
+
+    // Must be called without lock held, as continuations may run inline.
+    template <typename U>
+    void Wake(Promise<U> &&p, U &&value) {
+        if (executor_) {
+            executor_->Submit([p = std::move(p), value = std::move(value)]() mutable {
+                std::move(p).SetValue(std::move(value));
+            });
+        } else {
+            std::move(p).SetValue(std::move(value));
+        }
+    }
+
+    static std::exception_ptr ClosedError() {
+        return std::make_exception_ptr(std::runtime_error("send to closed channel"));
+    }
+
+    Future<Unit> MakeClosedError() {
+        auto f = Future<Unit>::MakeException(ClosedError());
+        f.SetExecutor(executor_);
+        return f;
+    }
+
+private:
+    const size_t capacity_;
+    exec::IExecutor *const executor_;
+
+    std::mutex mutex_;
+    bool closed_ {false};
+    std::deque<T> buffer_;
+    // At most one of `senders_` and `receivers_` is non-empty.
+    std::deque<PendingSend> senders_;
+    std::deque<Promise<std::optional<T>>> receivers_;
+};
+
+}   // namespace async
@@ -6,6 +6,7 @@
 #include <mutex>
 #include <optional>
 
+#include "async/result.h"
 #include "async/shared_state.h"
 
 namespace async {
@@ -39,13 +40,40 @@ public:
 
     // Movable
     Future(Future&&) = default;
-    Future& operator=(Future&&) = default;
+    Future& operator=(Future &&other) noexcept {
+        if (this != &other) {
+            DropDeferred();
+            state_ = std::move(other.state_);
+        }
+        return *this;
+    }
 
-    ~Future() noexcept = default;
+    ~Future() noexcept {
+        DropDeferred();
+    }
 
     // One-shot
     // Wait for result (value or exception)
+    // Deferred task is run here in the caller's context.
     T Get() {
+        return ValueOrRethrow(GetResult());
+    }
+
+    // Wait for result (value or exception)
+    // Doesn't run deferred task.
+    std::optional<T> TryGet() {
+        auto result = TryGetResult();
+        if (!result.has_value()) {
+            return {};
+        }
+        return ValueOrRethrow(std::move(result.value()));
+    }
+
+    // One-shot
+    // Wait for result, exception is returned as an error instead of being rethrown
+    Result<T, std::exception_ptr> GetResult() {
+        RunDeferred();
+
         std::unique_lock lg{state_->state_mutex};
         // Relaxed due to being under lock.
         auto s = state_->state.load(std::memory_order_relaxed);
@@ -63,8 +91,8 @@ public:
         return GetUnderLock();
     }
 
-    // Wait for result (value or exception)
-    std::optional<T> TryGet() {
+    // Wait for result, exception is returned as an error instead of being rethrown
+    std::optional<Result<T, std::exception_ptr>> TryGetResult() {
         // Sequential due to no lock held.
         auto s = state_->state.load();
         if (s == async::_detail::SharedState<T>::INIT) {
@@ -77,11 +105,19 @@ public:
         return GetUnderLock();
     }
 
+    // Deferred task is run here in the caller's context.
     template <_detail::VoidReturnContinuation<T> F>
     void Then(F &&continuation) {
+        RunDeferred();
         state_->SetContinuation(std::move(continuation));
     }
 
+    // Task fulfilling this future on the first `Get`/`Then`.
+    void SetDeferred(exec::Task task) {
+        assert(!state_->deferred.has_value());
+        state_->deferred.emplace(std::move(task));
+    }
+
     exec::IExecutor *GetExecutor() {
         return state_->executor;
     }
@@ -95,7 +131,23 @@ private:
         assert(state_ != nullptr);
     }
 
-    T GetUnderLock() {
+    void RunDeferred() {
+        if (state_->deferred.has_value()) {
+            auto task = std::move(state_->deferred.value());
+            state_->deferred.reset();
+            task();
+        }
+    }
+
+    // Deferred task owns the promise of this future and thus its shared state,
+    // drop it if it was never run to break the cycle.
+    void DropDeferred() {
+        if (state_ != nullptr) {
+            state_->deferred.reset();
+        }
+    }
+
+    Result<T, std::exception_ptr> GetUnderLock() {
         // Relaxed due to being under lock.
         auto state_number = state_->state.load(std::memory_order_relaxed);
         assert(state_number != async::_detail::SharedState<T>::INIT);
@@ -111,21 +163,28 @@ private:
                 return state_->result.value();
             }
             assert((state_->exception) && "result must hold exception");
-            std::rethrow_exception(state_->exception);
+            return Fail(state_->exception);
         } else {
             // otherwise it violates future-promise contract
             throw std::runtime_error("double call to Future::Get");
         }
     }
 
-    T GetReadyResult() {
+    Result<T, std::exception_ptr> GetReadyResult() {
         if (state_->exception) {
-            std::rethrow_exception(state_->exception);
+            return Fail(state_->exception);
         }
         assert(state_->result.has_value());
         return state_->result.value();
     }
 
+    static T ValueOrRethrow(Result<T, std::exception_ptr> &&result) {
+        if (!result.HasValue()) {
+            std::rethrow_exception(std::move(result).Error());
+        }
+        return std::move(result).Value();
+    }
+
 private:
     template <typename U>
     friend class Promise;
@@ -136,4 +195,22 @@ private:
 
 static_assert(std::is_move_assignable<Future<int>>::value);
 
+namespace _detail {
+
+// Unwraps one level of `Future`: Future<T> -> T, any other T -> T.
+template <typename T>
+struct Unwrap {
+    using Type = T;
+};
+
+template <typename T>
+struct Unwrap<Future<T>> {
+    using Type = T;
+};
+
+template <typename T>
+concept FutureType = !std::same_as<typename Unwrap<T>::Type, T>;
+
+}   // namespace _detail
+
 }  // namespace async
@@ -71,6 +71,13 @@ private:
             // State transition.
             // Relaxed due to being under lock.
             state_->state.store(async::_detail::SharedState<U>::READY, std::memory_order_relaxed);
+#ifdef ASYNC_TRACING
+            if (trace::IsEnabled()) {
+                state_->trace_flow_id = trace::NextFlowId();
+                trace::Record(trace::FULFIL, trace::Phase::INSTANT);
+                trace::Record(trace::CONTINUATION, trace::Phase::FLOW_START, state_->trace_flow_id);
+            }
+#endif
             // `notify_all` due to mutliple threads possibly waiting in `Future::Get`
             // - after waking up all of them, only one will eventually get the result,
             // while others will catch exception due to interface misuse
@@ -89,9 +96,9 @@ private:
             while (state_->futures_counter.load() != 4) {
                 asm volatile("pause");
             }
-            std::invoke(state_->continuation.value(), *state_);
+            state_->RunContinuation(state_->continuation.value());
         } else if (prev == 3) {
-            std::invoke(state_->continuation.value(), *state_);
+            state_->RunContinuation(state_->continuation.value());
         } else {
             // Future must be already created.
             assert(prev == 1);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace async {
+
+// Wrapper marking a value as an error, so Result<T, E> can be built
+// unambiguously even if T and E are the same type.
+template <typename E>
+struct Failure {
+    E error;
+};
+
+template <typename E>
+Failure<std::decay_t<E>> Fail(E &&error) {
+    return Failure<std::decay_t<E>>{std::forward<E>(error)};
+}
+
+// Either a value or an error, passed around without throwing.
+template <typename T, typename E>
+class Result {
+public:
+    using ValueType = T;
+    using ErrorType = E;
+
+public:
+    Result(T value) : storage_(std::in_place_index<0>, std::move(value)) {}
+
+    template <typename G>
+    requires std::constructible_from<E, G&&>
+    Result(Failure<G> failure) : storage_(std::in_place_index<1>, std::move(failure.error)) {}
+
+    // Copyable
+    Result(const Result&) = default;
+    Result& operator=(const Result&) = default;
+
+    // Movable
+    Result(Result&&) = default;
+    Result& operator=(Result&&) = default;
+
+    ~Result() noexcept = default;
+
+    bool HasValue() const {
+        return storage_.index() == 0;
+    }
+
+    explicit operator bool() const {
+        return HasValue();
+    }
+
+    T &Value() & {
+        assert(HasValue());
+        return std::get<0>(storage_);
+    }
+
+    const T &Value() const & {
+        assert(HasValue());
+        return std::get<0>(storage_);
+    }
+
+    T &&Value() && {
+        assert(HasValue());
+        return std::get<0>(std::move(storage_));
+    }
+
+    E &Error() & {
+        assert(!HasValue());
+        return std::get<1>(storage_);
+    }
+
+    const E &Error() const & {
+        assert(!HasValue());
+        return std::get<1>(storage_);
+    }
+
+    E &&Error() && {
+        assert(!HasValue());
+        return std::get<1>(std::move(storage_));
+    }
+
+private:
+    std::variant<T, E> storage_;
+};
+
+namespace _detail {
+
+template <typename T>
+struct IsResult : std::false_type {};
+
+template <typename T, typename E>
+struct IsResult<Result<T, E>> : std::true_type {};
+
+template <typename T>
+concept ResultType = IsResult<T>::value;
+
+// R if it is already a Result, Result<R, E> otherwise.
+template <typename R, typename E>
+struct ToResult {
+    using Type = Result<R, E>;
+};
+
+template <typename T, typename E, typename G>
+struct ToResult<Result<T, G>, E> {
+    using Type = Result<T, G>;
+};
+
+}   // namespace _detail
+
+}   // namespace async
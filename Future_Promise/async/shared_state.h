@@ -10,6 +10,7 @@
 #include <function2/function2.hpp>
 
 #include "exec/executor.h"
+#include "trace/trace.h"
 
 namespace async::_detail {
 
@@ -23,7 +24,8 @@ public:
     static std::shared_ptr<SharedState<T>> MakeResult(T &&value) {
         auto res = std::make_shared<SharedState<T>>();
         res->state.store(READY);
-        res->futures_counter.store(1, std::memory_order_relaxed);
+        // Future is created and result is set.
+        res->futures_counter.store(2, std::memory_order_relaxed);
 
         res->result = std::move(value);
         return res;
@@ -32,7 +34,8 @@ public:
     static std::shared_ptr<SharedState<T>> MakeException(std::exception_ptr ptr) {
         auto res = std::make_shared<SharedState<T>>();
         res->state.store(READY);
-        res->futures_counter.store(1, std::memory_order_relaxed);
+        // Future is created and result is set.
+        res->futures_counter.store(2, std::memory_order_relaxed);
 
         res->exception = std::move(ptr);
         return res;
@@ -62,10 +65,18 @@ public:
         } else {
             // Otherwise future must be already created and value is ready - can call right away.
             assert(prev == 2);
-            f(*this);
+            RunContinuation(f);
         }
     }
 
+    template <typename F>
+    void RunContinuation(F &f) {
+#ifdef ASYNC_TRACING
+        trace::Scope scope(trace::CONTINUATION, trace_flow_id);
+#endif
+        f(*this);
+    }
+
 public:
     // States.
     static constexpr uint32_t INIT = 0;
@@ -83,6 +94,14 @@ public:
 
     exec::IExecutor *executor {nullptr};
     std::optional<Callback> continuation;
+
+    // Set for `Launch::deferred`, run by the consumer.
+    std::optional<exec::Task> deferred;
+
+#ifdef ASYNC_TRACING
+    // Links fulfilment of the promise to the run of the continuation.
+    uint64_t trace_flow_id {0};
+#endif
 };
 
 }  // namespace async::_detail
@@ -2,6 +2,7 @@
 
 #include "async/future.h"
 #include "async/promise.h"
+#include "async/result.h"
 
 namespace async {
 
@@ -15,6 +16,61 @@ auto operator&(Future<T> &f, C continuation) {
     return continuation.And(f);
 }
 
+namespace _detail {
+
+// Forwards the result of `inner` into `p` once it is ready.
+// Never blocks: the forwarding is attached as a continuation of `inner`.
+template <typename T>
+void Forward(Future<T> &&inner, Promise<T> &&p) {
+    inner.Then([p = std::move(p)](SharedState<T> &state) mutable {
+        if (state.exception) {
+            std::move(p).SetException(state.exception);
+        } else {
+            assert(state.result.has_value());
+            std::move(p).SetValue(std::move(state.result.value()));
+        }
+    });
+}
+
+// Fulfills `p` with the result of `produce`.
+// If `produce` returns a future, `p` is fulfilled with its result instead.
+template <typename T, typename F>
+void Fulfill(Promise<T> &&p, F &&produce) {
+    try {
+        if constexpr (FutureType<std::invoke_result_t<F>>) {
+            Forward(produce(), std::move(p));
+        } else {
+            std::move(p).SetValue(produce());
+        }
+    } catch(...) {
+        std::move(p).SetException(std::current_exception());
+    }
+}
+
+// Continuation `F` accepting `T::ValueType` applied to `T = Result<...>`:
+// only the value is passed to `F`, errors are propagated as values.
+template <typename F, typename T>
+concept MapsResultValue = ResultType<T> &&
+    !std::invocable<F, T> &&
+    std::invocable<F, typename T::ValueType>;
+
+template <typename F, typename T>
+auto Apply(F &cont, T &&value) {
+    using V = std::remove_cvref_t<T>;
+    if constexpr (MapsResultValue<F, V>) {
+        using R = typename ToResult<std::invoke_result_t<F, typename V::ValueType>,
+                                    typename V::ErrorType>::Type;
+        if (!value.HasValue()) {
+            return R(Fail(std::forward<T>(value).Error()));
+        }
+        return R(cont(std::forward<T>(value).Value()));
+    } else {
+        return cont(std::forward<T>(value));
+    }
+}
+
+}   // namespace _detail
+
 namespace pipe {
 
 template <typename F>
@@ -26,8 +82,10 @@ struct [[nodiscard]] Then {
     // Non-copyable.
     Then(Then&) = delete;
 
+    // Continuations returning Future<U> are flattened into Future<U>.
     template <typename T>
-    using U = std::invoke_result_t<F, T>;
+    using U = typename _detail::Unwrap<
+        decltype(_detail::Apply(std::declval<F&>(), std::declval<T>()))>::Type;
 
     template <typename T>
     Future<U<T>> Pipe(Future<T> &&f) {
@@ -52,19 +110,13 @@ struct [[nodiscard]] Then {
                     state.executor->Submit([value = std::move(state.result.value()),
                                             p = std::move(p),
                                             cont = std::move(cont)]() mutable {
-                        try {
-                            std::move(p).SetValue(cont(value));
-                        } catch(...) {
-                            std::move(p).SetException(std::current_exception());
-                        }
+                        _detail::Fulfill(std::move(p), [&] { return _detail::Apply(cont, value); });
                     });
                 } else {
                     // Otherwise apply continuation immediately.
-                    try {
-                        std::move(p).SetValue(cont(std::move(state.result.value())));
-                    } catch(...) {
-                        std::move(p).SetException(std::current_exception());
-                    }
+                    _detail::Fulfill(std::move(p), [&] {
+                        return _detail::Apply(cont, std::move(state.result.value()));
+                    });
                 }
             }
         });
@@ -72,12 +124,70 @@ struct [[nodiscard]] Then {
     }
 };
 
+struct [[nodiscard]] Flatten {
+    template <typename T>
+    Future<T> Pipe(Future<Future<T>> &&f) {
+        return And(f);
+    }
+
+    template <typename T>
+    Future<T> And(Future<Future<T>> &f) {
+        Promise<T> p;
+        auto flat = p.MakeFuture();
+
+        flat.SetExecutor(f.GetExecutor());
+
+        f.Then([p = std::move(p)](_detail::SharedState<Future<T>> &state) mutable {
+            if (state.exception) {
+                std::move(p).SetException(state.exception);
+            } else {
+                assert(state.result.has_value());
+                _detail::Forward(std::move(state.result.value()), std::move(p));
+            }
+        });
+        return flat;
+    }
+};
+
 }   // namespace pipe
 
 // Future<T> -> (T -> Result<U>) -> Future<U>
+// Future<T> -> (T -> Future<U>) -> Future<U>
+// Future<Result<T, E>> -> (T -> U) -> Future<Result<U, E>>
+// Future<Result<T, E>> -> (T -> Result<U, E>) -> Future<Result<U, E>>
 template <typename F>
 auto Then(F fun) {
     return pipe::Then{std::move(fun)};
 }
 
+// Future<Future<T>> -> Future<T>
+inline auto Flatten() {
+    return pipe::Flatten{};
+}
+
+// Future<Result<T, E>> -> (E -> T) -> Future<Result<T, E>>
+// Future<Result<T, E>> -> (E -> Result<T, G>) -> Future<Result<T, G>>
+template <typename F>
+auto Recover(F fun) {
+    return Then([fun = std::move(fun)]<typename T, typename E>(Result<T, E> result) mutable {
+        using R = typename _detail::ToResult<std::invoke_result_t<F&, E>, E>::Type;
+        if (result.HasValue()) {
+            return R(std::move(result).Value());
+        }
+        return R(fun(std::move(result).Error()));
+    });
+}
+
+// Future<Result<T, E>> -> (E -> G) -> Future<Result<T, G>>
+template <typename F>
+auto MapError(F fun) {
+    return Then([fun = std::move(fun)]<typename T, typename E>(Result<T, E> result) mutable {
+        using R = Result<T, std::invoke_result_t<F&, E>>;
+        if (result.HasValue()) {
+            return R(std::move(result).Value());
+        }
+        return R(Fail(fun(std::move(result).Error())));
+    });
+}
+
 }   // namespace async
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace async {
+
+// Value of futures that only signal completion, stands in for `void`.
+struct Unit {
+    friend bool operator==(Unit, Unit) = default;
+};
+
+}   // namespace async
@@ -0,0 +1,49 @@
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "async/async.h"
+
+// Cost of launching a cheap task under each policy, from one thread and from
+// several at once: Launch::adaptive has to stay as cheap as Launch::sync.
+
+namespace {
+
+constexpr int ITERATIONS = 200000;
+constexpr int THREADS[] = {1, 4};
+
+int Cheap(int value) {
+    return value * 2 + 1;
+}
+
+double MeasureNsPerOp(async::Launch launch, int threads) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([launch]() {
+            volatile int sink = 0;
+            for (int i = 0; i < ITERATIONS; ++i) {
+                sink = sink + async::Async(launch, Cheap, i).Get();
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+}
+
+}   // namespace
+
+int main() {
+    std::printf("%8s %14s %18s %15s\n", "threads", "sync_ns/op", "adaptive_ns/op", "async_ns/op");
+    for (int threads : THREADS) {
+        double sync_ns = MeasureNsPerOp(async::Launch::sync, threads);
+        double adaptive_ns = MeasureNsPerOp(async::Launch::adaptive, threads);
+        double async_ns = MeasureNsPerOp(async::Launch::async, threads);
+        std::printf("%8d %14.1f %18.1f %15.1f\n", threads, sync_ns, adaptive_ns, async_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "async/async.h"
+#include "exec/reactor.h"
+
+// Compares reads on socket pairs whose data arrives late:
+// blocking `read` in `Async` tasks vs `Reactor::ReadAsync`.
+// Reports the wall time of the reads and how long CPU tasks submitted
+// meanwhile take to complete, i.e. how much the I/O starves the pool.
+
+namespace {
+
+constexpr int CONNECTIONS = 64;
+constexpr int CPU_TASKS = 1000;
+constexpr auto DATA_DELAY = std::chrono::milliseconds(20);
+
+using Clock = std::chrono::steady_clock;
+
+struct Connections {
+    Connections() {
+        for (auto &pair : sockets) {
+            socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+        }
+    }
+
+    ~Connections() {
+        for (auto &pair : sockets) {
+            close(pair[0]);
+            close(pair[1]);
+        }
+    }
+
+    // Peers send one value each after `DATA_DELAY`.
+    std::thread SendLater() {
+        return std::thread([this]() {
+            std::this_thread::sleep_for(DATA_DELAY);
+            for (int i = 0; i < CONNECTIONS; ++i) {
+                [[maybe_unused]] auto written = write(sockets[i][0], &i, sizeof(i));
+            }
+        });
+    }
+
+    int sockets[CONNECTIONS][2];
+};
+
+double Ms(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Time until `CPU_TASKS` small `Async` tasks are all done.
+double CpuLatencyMs() {
+    auto start = Clock::now();
+    std::vector<async::Future<int>> tasks;
+    for (int i = 0; i < CPU_TASKS; ++i) {
+        tasks.push_back(async::Async([i]() { return i * i; }));
+    }
+    for (auto &task : tasks) {
+        task.Get();
+    }
+    return Ms(Clock::now() - start);
+}
+
+template <typename StartReads>
+void Run(const char *name, StartReads &&start_reads) {
+    Connections connections;
+    auto sender = connections.SendLater();
+
+    auto start = Clock::now();
+    std::vector<async::Future<size_t>> reads = start_reads(connections);
+    double cpu_ms = CpuLatencyMs();
+    for (auto &read : reads) {
+        read.Get();
+    }
+    double io_ms = Ms(Clock::now() - start);
+    sender.join();
+
+    std::printf("%20s %12.2f %16.2f\n", name, io_ms, cpu_ms);
+}
+
+}   // namespace
+
+int main() {
+    std::vector<int> values(CONNECTIONS);
+
+    std::printf("%20s %12s %16s\n", "", "io_ms", "cpu_tasks_ms");
+
+    Run("blocking read", [&values](Connections &connections) {
+        std::vector<async::Future<size_t>> reads;
+        for (int i = 0; i < CONNECTIONS; ++i) {
+            reads.push_back(async::Async([fd = connections.sockets[i][1], value = &values[i]]() {
+                return static_cast<size_t>(read(fd, value, sizeof(*value)));
+            }));
+        }
+        return reads;
+    });
+
+    for (auto backend : {exec::Reactor::Backend::IO_URING, exec::Reactor::Backend::EPOLL}) {
+        exec::Reactor reactor(backend);
+        reactor.Start();
+        bool is_io_uring = reactor.GetBackend() == exec::Reactor::Backend::IO_URING;
+
+        Run(is_io_uring ? "reactor io_uring" : "reactor epoll", [&](Connections &connections) {
+            std::vector<async::Future<size_t>> reads;
+            for (int i = 0; i < CONNECTIONS; ++i) {
+                reads.push_back(reactor.ReadAsync(connections.sockets[i][1], &values[i], sizeof(int)));
+            }
+            return reads;
+        });
+    }
+    return 0;
+}
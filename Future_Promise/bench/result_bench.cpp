@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#include "async/future.h"
+#include "async/promise.h"
+#include "async/result.h"
+#include "async/then.h"
+
+// Compares failure propagation through a chain of `Then` stages:
+// exceptions (`SetException` + `std::rethrow_exception`) vs `Result<T, E>` values.
+
+namespace {
+
+constexpr int ITERATIONS = 200000;
+constexpr int ERROR_RATES[] = {0, 1, 5, 10, 25, 50};
+
+enum class Error {
+    CACHE_MISS,
+};
+
+using IntResult = async::Result<int, Error>;
+
+bool IsFailure(int i, int error_rate) {
+    return i % 100 < error_rate;
+}
+
+int ExceptionPipeline(int i, int error_rate) {
+    async::Promise<int> p;
+    auto f = p.MakeFuture() |
+        async::Then([error_rate](int value) {
+            if (IsFailure(value, error_rate)) {
+                throw std::runtime_error("cache miss");
+            }
+            return value + 1;
+        }) |
+        async::Then([](int value) { return value * 2; }) |
+        async::Then([](int value) { return value - 1; });
+
+    std::move(p).SetValue(i);
+    try {
+        return f.Get();
+    } catch (const std::runtime_error &) {
+        return -1;
+    }
+}
+
+int ResultPipeline(int i, int error_rate) {
+    async::Promise<IntResult> p;
+    auto f = p.MakeFuture() |
+        async::Then([error_rate](int value) -> IntResult {
+            if (IsFailure(value, error_rate)) {
+                return async::Fail(Error::CACHE_MISS);
+            }
+            return value + 1;
+        }) |
+        async::Then([](int value) { return value * 2; }) |
+        async::Then([](int value) { return value - 1; });
+
+    std::move(p).SetValue(IntResult(i));
+    auto result = f.Get();
+    return result.HasValue() ? result.Value() : -1;
+}
+
+template <typename F>
+double MeasureNsPerOp(F &&pipeline, int error_rate) {
+    volatile int sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        sink = sink + pipeline(i, error_rate);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+}
+
+}   // namespace
+
+int main() {
+    std::printf("%12s %16s %16s %10s\n", "error_rate", "exception_ns/op", "result_ns/op", "speedup");
+    for (int error_rate : ERROR_RATES) {
+        double exception_ns = MeasureNsPerOp(ExceptionPipeline, error_rate);
+        double result_ns = MeasureNsPerOp(ResultPipeline, error_rate);
+        std::printf("%11d%% %16.1f %16.1f %9.2fx\n",
+                    error_rate, exception_ns, result_ns, exception_ns / result_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include "exec/limiter.h"
+
+namespace exec {
+
+namespace {
+
+const char *Describe(Limiter::Admission reason) {
+    switch (reason) {
+        case Limiter::Admission::ACCEPTED:
+            return "task accepted";
+        case Limiter::Admission::QUEUE_FULL:
+            return "limiter queue is full";
+        case Limiter::Admission::SHED:
+            return "task shed by limiter due to its priority";
+    }
+    return "";
+}
+
+}   // namespace
+
+Limiter::RejectedError::RejectedError(Admission reason)
+        : std::runtime_error(Describe(reason)), reason_(reason) {}
+
+Limiter::Admission Limiter::RejectedError::Reason() const {
+    return reason_;
+}
+
+Limiter::Limiter(IExecutor &executor, size_t limit, size_t queue_capacity)
+        : executor_(executor), queue_capacity_(queue_capacity), queue_(std::max<size_t>(queue_capacity, 1)),
+          limit_(limit) {
+    assert(limit > 0);
+}
+
+Limiter::~Limiter() {
+    while (tasks_.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void Limiter::SetAdaptive(size_t min_limit, size_t max_limit) {
+    assert(0 < min_limit && min_limit <= max_limit);
+    std::lock_guard lg{adapt_mutex_};
+    adaptive_ = true;
+    min_limit_ = min_limit;
+    max_limit_ = max_limit;
+    limit_.store(std::clamp(limit_.load(), min_limit, max_limit));
+}
+
+Limiter::Admission Limiter::TrySubmit(Task task, Priority priority) {
+    // Skip the queue only if nobody waits, to keep FIFO order.
+    if (waiting_.load() == 0 && TryAcquire()) {
+        tasks_.fetch_add(1);
+        Run(std::move(task));
+        return Admission::ACCEPTED;
+    }
+    saturated_.store(true, std::memory_order_relaxed);
+
+    size_t waiting = waiting_.fetch_add(1);
+    if (waiting >= AllowedWaiting(priority)) {
+        waiting_.fetch_sub(1);
+        return (waiting >= queue_capacity_) ? Admission::QUEUE_FULL : Admission::SHED;
+    }
+
+    tasks_.fetch_add(1);
+    // The slot is reserved, the put fails only while a consumer is vacating it.
+    while (!queue_.TryPut(task)) {
+        std::this_thread::yield();
+    }
+    // A slot could have been released before the task was put.
+    Drain();
+    return Admission::ACCEPTED;
+}
+
+void Limiter::Submit(Task task) {
+    Submit(std::move(task), Priority::NORMAL);
+}
+
+void Limiter::Submit(Task task, Priority priority) {
+    auto admission = TrySubmit(std::move(task), priority);
+    if (admission != Admission::ACCEPTED) {
+        throw RejectedError(admission);
+    }
+}
+
+size_t Limiter::Limit() const {
+    return limit_.load();
+}
+
+size_t Limiter::Running() const {
+    return running_.load();
+}
+
+size_t Limiter::Waiting() const {
+    return waiting_.load();
+}
+
+size_t Limiter::Dropped() const {
+    return dropped_.load();
+}
+
+size_t Limiter::AllowedWaiting(Priority priority) const {
+    switch (priority) {
+        case Priority::LOW:
+            return queue_capacity_ * LOW_SHARE_PERCENT / 100;
+        case Priority::NORMAL:
+            return queue_capacity_ * NORMAL_SHARE_PERCENT / 100;
+        case Priority::HIGH:
+            return queue_capacity_;
+    }
+    return 0;
+}
+
+bool Limiter::TryAcquire() {
+    size_t running = running_.load();
+    do {
+        if (running >= limit_.load()) {
+            return false;
+        }
+    } while (!running_.compare_exchange_weak(running, running + 1));
+    return true;
+}
+
+void Limiter::Release() {
+    running_.fetch_sub(1);
+}
+
+void Limiter::Run(Task task) {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        executor_.Submit([this, task = std::move(task), start]() mutable {
+            // Runs even if the task throws.
+            struct Completion {
+                ~Completion() {
+                    limiter->OnComplete(std::chrono::steady_clock::now() - start);
+                    limiter->Release();
+                    limiter->Drain();
+                    // Last access to the limiter.
+                    limiter->tasks_.fetch_sub(1);
+                }
+
+                Limiter *limiter;
+                std::chrono::steady_clock::time_point start;
+            } completion {this, start};
+
+            task();
+        });
+    } catch (...) {
+        // The task never runs, give back its slot.
+        Release();
+        tasks_.fetch_sub(1);
+        throw;
+    }
+}
+
+void Limiter::Drain() {
+    while (waiting_.load() > 0 && TryAcquire()) {
+        auto task = queue_.TryTake();
+        if (!task) {
+            // Reserved but not put yet, its submitter drains after the put.
+            Release();
+            return;
+        }
+        waiting_.fetch_sub(1);
+        try {
+            Run(std::move(task.value()));
+        } catch (...) {
+            // Runs on the thread of another task, nobody to report to.
+            dropped_.fetch_add(1);
+        }
+    }
+}
+
+void Limiter::OnComplete(std::chrono::nanoseconds latency) {
+    // Set before any submission, no need to lock.
+    if (!adaptive_) {
+        return;
+    }
+
+    std::lock_guard lg{adapt_mutex_};
+    min_latency_ = std::min(min_latency_, latency);
+    if (latency > min_latency_ * LATENCY_TOLERANCE) {
+        congested_ = true;
+    }
+
+    // One decision per window of `limit` completions, so that the effect of
+    // the previous decision is observed first.
+    size_t limit = limit_.load();
+    if (++window_completions_ < limit) {
+        return;
+    }
+
+    if (congested_) {
+        limit = std::max(min_limit_, limit - std::max<size_t>(limit / 4, 1));
+        // Let the baseline follow a downstream that got slower for good.
+        min_latency_ += min_latency_ / 8;
+    } else if (saturated_.load(std::memory_order_relaxed)) {
+        limit = std::min(max_limit_, limit + 1);
+    }
+    limit_.store(limit);
+
+    window_completions_ = 0;
+    congested_ = false;
+    saturated_.store(false, std::memory_order_relaxed);
+}
+
+}  // namespace exec
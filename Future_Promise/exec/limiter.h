@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+
+#include "exec/executor.h"
+#include "exec/queue.h"
+
+namespace exec {
+
+// Bulkhead around an executor for downstream resources that take only a few
+// concurrent operations.
+// At most `Limit()` tasks are in `executor` at a time, excess tasks wait in a
+// bounded lock-free queue and are started in FIFO order as running ones finish.
+//
+// Load is shed at submission: when the queue is past the share allowed for a
+// priority (half of it for LOW, 90% for NORMAL, all of it for HIGH)
+// the task is rejected instead of timing out later in the pipeline.
+//
+// In adaptive mode the limit follows the latency of tasks (AIMD):
+// it is cut by a quarter when tasks take much longer than the fastest ones seen,
+// and grows by one when tasks had to wait in the queue and latency stayed low.
+//
+// A queued task that `executor` refuses once its turn comes is dropped and
+// counted in `Dropped()`, its submitter is long gone.
+//
+// Must outlive its tasks, the destructor waits for queued and running ones.
+
+class Limiter : public IExecutor {
+public:
+    enum class Priority {
+        LOW,
+        NORMAL,
+        HIGH,
+    };
+
+    enum class Admission {
+        ACCEPTED,
+        // No room left in the queue.
+        QUEUE_FULL,
+        // Queue is past the share allowed for the task priority.
+        SHED,
+    };
+
+    class RejectedError : public std::runtime_error {
+    public:
+        explicit RejectedError(Admission reason);
+
+        Admission Reason() const;
+
+    private:
+        Admission reason_;
+    };
+
+public:
+    Limiter(IExecutor &executor, size_t limit, size_t queue_capacity);
+
+    // Non-copyable
+    Limiter(const Limiter&) = delete;
+    Limiter& operator=(const Limiter&) = delete;
+
+    // Non-movable
+    Limiter(Limiter&&) = delete;
+    Limiter& operator=(Limiter&&) = delete;
+
+    ~Limiter();
+
+    // Lets the limit move within [min_limit, max_limit].
+    // Must be called before any submission.
+    void SetAdaptive(size_t min_limit, size_t max_limit);
+
+    // Rejected tasks are dropped.
+    Admission TrySubmit(Task task, Priority priority = Priority::NORMAL);
+
+    // IExecutor
+    // Throws `RejectedError` if the task is rejected.
+    void Submit(Task task);
+
+    void Submit(Task task, Priority priority);
+
+    size_t Limit() const;
+    size_t Running() const;
+    size_t Waiting() const;
+    size_t Dropped() const;
+
+private:
+    size_t AllowedWaiting(Priority priority) const;
+
+    bool TryAcquire();
+    void Release();
+    // Throws what the executor throws, the task is not accepted then.
+    void Run(Task task);
+    // Starts queued tasks while there are free slots, never throws.
+    void Drain();
+    void OnComplete(std::chrono::nanoseconds latency);
+
+private:
+    // Latency above the fastest seen times this counts as congestion.
+    static constexpr int LATENCY_TOLERANCE = 2;
+
+    static constexpr size_t LOW_SHARE_PERCENT = 50;
+    static constexpr size_t NORMAL_SHARE_PERCENT = 90;
+
+    IExecutor &executor_;
+
+    const size_t queue_capacity_;
+    BoundedLockFreeQueue<Task> queue_;
+
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> running_ {0};
+    // Reserved queue slots, including tasks about to be put.
+    std::atomic<size_t> waiting_ {0};
+    // Accepted tasks not yet finished.
+    std::atomic<size_t> tasks_ {0};
+    // Queued tasks refused by the executor.
+    std::atomic<size_t> dropped_ {0};
+    // Some task had to wait since the last limit update.
+    std::atomic<bool> saturated_ {false};
+
+    bool adaptive_ {false};
+    std::mutex adapt_mutex_;
+    // Guarded by `adapt_mutex_`.
+    size_t min_limit_ {0};
+    size_t max_limit_ {0};
+    std::chrono::nanoseconds min_latency_ {std::chrono::nanoseconds::max()};
+    size_t window_completions_ {0};
+    bool congested_ {false};
+};
+
+}  // namespace exec
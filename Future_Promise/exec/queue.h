@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
 #include <condition_variable>
+#include <cstddef>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 
@@ -59,4 +63,83 @@ private:
     std::mutex take_mutex_;
 };
 
+// Bounded lock-free MPMC queue (Vyukov's array queue).
+// Capacity is rounded up to a power of two.
+// Non-blocking: `TryPut` fails when full, `TryTake` when empty.
+
+template <typename T>
+class BoundedLockFreeQueue {
+public:
+    explicit BoundedLockFreeQueue(size_t capacity)
+            : mask_(std::bit_ceil(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Non-copyable
+    BoundedLockFreeQueue(const BoundedLockFreeQueue&) = delete;
+    BoundedLockFreeQueue& operator=(const BoundedLockFreeQueue&) = delete;
+
+    bool TryPut(T &elem) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells_[pos & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                // Cell is free, claim it.
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value.emplace(std::move(elem));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // Cell still holds the value from the previous lap.
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> TryTake() {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells_[pos & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> ret {std::move(cell.value)};
+                    cell.value.reset();
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return ret;
+                }
+            } else if (diff < 0) {
+                // Cell is not filled yet.
+                return std::nullopt;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+private:
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    // Separate cache lines for producers and consumers.
+    alignas(CACHE_LINE) std::atomic<size_t> tail_ {0};
+    alignas(CACHE_LINE) std::atomic<size_t> head_ {0};
+};
+
 }  // namespace exec
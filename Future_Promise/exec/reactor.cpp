@@ -0,0 +1,635 @@
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <system_error>
+
+#include "exec/reactor.h"
+
+namespace exec {
+
+namespace {
+
+// Completion of the eventfd read used to wake the io_uring loop.
+constexpr uint64_t WAKE_TAG = 0;
+// Completions of cancel requests, nothing to do with them.
+constexpr uint64_t CANCEL_TAG = ~uint64_t(0);
+
+// Operation in slot `i` is tagged `(i + 1) << 1`,
+// the poll request linked in front of it has the lowest bit set.
+uint64_t OperationTag(size_t slot) {
+    return (slot + 1) << 1;
+}
+
+uint64_t PollTag(size_t slot) {
+    return OperationTag(slot) | 1;
+}
+
+size_t TagSlot(uint64_t tag) {
+    return (tag >> 1) - 1;
+}
+
+[[noreturn]] void ThrowErrno(const char *what) {
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+}   // namespace
+
+// Minimal io_uring setup over raw syscalls: a submission and a completion ring
+// shared with the kernel.
+struct Reactor::IoUring {
+    static constexpr unsigned ENTRIES = 256;
+
+    // Returns nullptr if the kernel doesn't allow io_uring.
+    static std::unique_ptr<IoUring> TryCreate() {
+        io_uring_params params {};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, ENTRIES, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        std::unique_ptr<IoUring> ring(new IoUring);
+        ring->fd = fd;
+
+        // Without NODROP completions beyond the CQ size are lost.
+        if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            return nullptr;
+        }
+
+        size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring->rings_size = std::max(sq_size, cq_size);
+        ring->rings = mmap(nullptr, ring->rings_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring->rings == MAP_FAILED) {
+            ring->rings = nullptr;
+            return nullptr;
+        }
+
+        ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto *base = static_cast<char*>(ring->rings);
+        ring->sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        ring->sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        ring->sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        ring->sq_entries = params.sq_entries;
+        ring->sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        ring->cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        ring->cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        ring->cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+        return ring;
+    }
+
+    ~IoUring() {
+        if (sqes) {
+            munmap(sqes, sqes_size);
+        }
+        if (rings) {
+            munmap(rings, rings_size);
+        }
+        close(fd);
+    }
+
+    // Returns a zeroed entry, flushing the queue to the kernel if it is full.
+    io_uring_sqe *NextSqe() {
+        if (queued == sq_entries) {
+            Enter(0);
+        }
+        unsigned index = (local_tail++) & sq_mask;
+        sq_array[index] = index;
+        ++queued;
+
+        io_uring_sqe *sqe = &sqes[index];
+        *sqe = io_uring_sqe {};
+        return sqe;
+    }
+
+    // Submits queued entries in one syscall, then waits for `wait_for` completions.
+    void Enter(unsigned wait_for) {
+        std::atomic_ref<unsigned>(*sq_tail).store(local_tail, std::memory_order_release);
+        while (true) {
+            unsigned flags = wait_for > 0 ? IORING_ENTER_GETEVENTS : 0;
+            long submitted = syscall(__NR_io_uring_enter, fd, queued, wait_for, flags, nullptr, 0);
+            if (submitted >= 0) {
+                queued -= static_cast<unsigned>(submitted);
+                if (queued == 0) {
+                    return;
+                }
+                // Kernel is short of resources, completions have to be reaped first.
+                wait_for = 0;
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                ThrowErrno("io_uring_enter");
+            }
+        }
+    }
+
+    // Calls `handle(user_data, res)` for every available completion.
+    template <typename F>
+    void Reap(F &&handle) {
+        unsigned head = *cq_head;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes[head & cq_mask];
+            handle(cqe.user_data, cqe.res);
+        }
+        std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+    }
+
+    int fd {-1};
+
+    void *rings {nullptr};
+    size_t rings_size {0};
+    io_uring_sqe *sqes {nullptr};
+    size_t sqes_size {0};
+
+    unsigned *sq_head {nullptr};
+    unsigned *sq_tail {nullptr};
+    unsigned *sq_array {nullptr};
+    unsigned sq_mask {0};
+    unsigned sq_entries {0};
+    // Entries filled but not yet consumed by the kernel.
+    unsigned local_tail {0};
+    unsigned queued {0};
+
+    unsigned *cq_head {nullptr};
+    unsigned *cq_tail {nullptr};
+    unsigned cq_mask {0};
+    io_uring_cqe *cqes {nullptr};
+
+    // Target of the eventfd read.
+    uint64_t wake_value {0};
+};
+
+Reactor::Reactor(Backend preferred) {
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        ThrowErrno("eventfd");
+    }
+
+    if (preferred == Backend::IO_URING) {
+        ring_ = IoUring::TryCreate();
+    }
+
+    if (ring_) {
+        backend_ = Backend::IO_URING;
+        ring_->local_tail = *ring_->sq_tail;
+    } else {
+        backend_ = Backend::EPOLL;
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            close(wake_fd_);
+            ThrowErrno("epoll_create1");
+        }
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = wake_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+    }
+}
+
+Reactor::~Reactor() {
+    Stop();
+    ring_.reset();
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+    close(wake_fd_);
+}
+
+void Reactor::Start() {
+    std::call_once(started_, [this]() {
+        loop_ = std::thread([this]() {
+            if (backend_ == Backend::IO_URING) {
+                IoUringLoop();
+            } else {
+                EpollLoop();
+            }
+        });
+    });
+}
+
+void Reactor::Stop() {
+    {
+        std::lock_guard lock(pending_mutex_);
+        stopped_ = true;
+    }
+    Wake();
+    if (loop_.joinable()) {
+        loop_.join();
+    }
+
+    // Never started.
+    std::vector<OperationPtr> ops;
+    TakePending(ops);
+    FailAll(std::move(ops));
+}
+
+Reactor::Backend Reactor::GetBackend() const {
+    return backend_;
+}
+
+async::Future<size_t> Reactor::ReadAsync(int fd, void *buf, size_t len, IExecutor *executor) {
+    return Submit(OperationPtr(new Operation{Operation::READ, fd, buf, len, 0, executor, {}}));
+}
+
+async::Future<size_t> Reactor::WriteAsync(int fd, const void *buf, size_t len, IExecutor *executor) {
+    return Submit(OperationPtr(new Operation{Operation::WRITE, fd, const_cast<void*>(buf), len, 0,
+                                             executor, {}}));
+}
+
+async::Future<size_t> Reactor::ReadFileAsync(int fd, void *buf, size_t len, off_t offset,
+                                             IExecutor *executor) {
+    return Submit(OperationPtr(new Operation{Operation::PREAD, fd, buf, len, offset, executor, {}}));
+}
+
+async::Future<size_t> Reactor::Submit(OperationPtr op) {
+    auto f = op->promise.MakeFuture();
+    f.SetExecutor(op->executor);
+
+    bool wake = false;
+    {
+        std::lock_guard lock(pending_mutex_);
+        if (!stopped_) {
+            // Operations submitted while the loop is busy share one wake-up
+            // and one submission syscall.
+            wake = pending_.empty();
+            pending_.push_back(std::move(op));
+        }
+    }
+
+    if (op) {
+        Complete(std::move(op), -ECANCELED);
+    } else if (wake) {
+        Wake();
+    }
+    return f;
+}
+
+bool Reactor::TakePending(std::vector<OperationPtr> &ops) {
+    std::lock_guard lock(pending_mutex_);
+    ops.swap(pending_);
+    return !stopped_;
+}
+
+void Reactor::Wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = write(wake_fd_, &one, sizeof(one));
+}
+
+/* static */
+void Reactor::Complete(OperationPtr op, ssize_t result) {
+    auto fulfill = [](OperationPtr op, ssize_t result) {
+        if (result < 0) {
+            auto error = std::system_error(static_cast<int>(-result), std::system_category(), "reactor I/O");
+            std::move(op->promise).SetException(std::make_exception_ptr(error));
+        } else {
+            std::move(op->promise).SetValue(static_cast<size_t>(result));
+        }
+    };
+
+    if (op->executor) {
+        auto *executor = op->executor;
+        executor->Submit([fulfill, op = std::move(op), result]() mutable {
+            fulfill(std::move(op), result);
+        });
+    } else {
+        fulfill(std::move(op), result);
+    }
+}
+
+/* static */
+void Reactor::FailAll(std::vector<OperationPtr> ops) {
+    for (auto &op : ops) {
+        Complete(std::move(op), -ECANCELED);
+    }
+}
+
+void Reactor::IoUringLoop() {
+    IoUring &ring = *ring_;
+
+    // In-flight operations, indexed by the slot encoded in their tag.
+    std::vector<OperationPtr> slots;
+    std::vector<size_t> free_slots;
+    // Operations that got EAGAIN on a non-blocking fd, resubmitted behind a poll.
+    std::vector<OperationPtr> retries;
+    // io_uring doesn't order concurrent requests on the same fd, so stream
+    // reads (and writes) are kept one in flight per fd, the rest queue here.
+    std::unordered_map<uint64_t, std::deque<OperationPtr>> streams;
+    size_t inflight = 0;
+    bool wake_armed = false;
+
+    auto arm_wake = [&]() {
+        io_uring_sqe *sqe = ring.NextSqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&ring.wake_value);
+        sqe->len = sizeof(ring.wake_value);
+        sqe->user_data = WAKE_TAG;
+        wake_armed = true;
+    };
+
+    auto prepare = [&](OperationPtr op, bool poll_first) {
+        size_t slot;
+        if (free_slots.empty()) {
+            slot = slots.size();
+            slots.emplace_back();
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+
+        if (poll_first) {
+            io_uring_sqe *poll = ring.NextSqe();
+            poll->opcode = IORING_OP_POLL_ADD;
+            poll->fd = op->fd;
+            poll->poll32_events = (op->kind == Operation::WRITE) ? POLLOUT : POLLIN;
+            poll->flags = IOSQE_IO_LINK;
+            poll->user_data = PollTag(slot);
+        }
+
+        io_uring_sqe *sqe = ring.NextSqe();
+        sqe->opcode = (op->kind == Operation::WRITE) ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd = op->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(op->buf);
+        sqe->len = static_cast<uint32_t>(op->len);
+        // -1 means the current file position, like read(2)/write(2).
+        sqe->off = (op->kind == Operation::PREAD) ? static_cast<uint64_t>(op->offset) : ~uint64_t(0);
+        sqe->user_data = OperationTag(slot);
+
+        slots[slot] = std::move(op);
+        ++inflight;
+    };
+
+    auto stream_key = [](const Operation &op) {
+        return (static_cast<uint64_t>(op.fd) << 1) | (op.kind == Operation::WRITE);
+    };
+
+    auto submit = [&](OperationPtr op) {
+        if (op->kind == Operation::PREAD) {
+            prepare(std::move(op), false);
+            return;
+        }
+        auto [it, idle] = streams.try_emplace(stream_key(*op));
+        if (idle) {
+            prepare(std::move(op), false);
+        } else {
+            it->second.push_back(std::move(op));
+        }
+    };
+
+    auto handle = [&](uint64_t tag, int32_t res) {
+        if (tag == WAKE_TAG) {
+            wake_armed = false;
+            return;
+        }
+        if (tag == CANCEL_TAG || (tag & 1)) {
+            // The linked operation reports the outcome of its poll.
+            return;
+        }
+
+        size_t slot = TagSlot(tag);
+        OperationPtr op = std::move(slots[slot]);
+        free_slots.push_back(slot);
+        --inflight;
+
+        if (res == -EAGAIN) {
+            retries.push_back(std::move(op));
+            return;
+        }
+
+        auto it = (op->kind == Operation::PREAD) ? streams.end() : streams.find(stream_key(*op));
+        Complete(std::move(op), res);
+        if (it != streams.end()) {
+            if (it->second.empty()) {
+                streams.erase(it);
+            } else {
+                OperationPtr next = std::move(it->second.front());
+                it->second.pop_front();
+                prepare(std::move(next), false);
+            }
+        }
+    };
+
+    std::vector<OperationPtr> ops;
+    while (TakePending(ops)) {
+        if (!wake_armed) {
+            arm_wake();
+        }
+        for (auto &op : ops) {
+            submit(std::move(op));
+        }
+        ops.clear();
+        for (auto &op : retries) {
+            prepare(std::move(op), true);
+        }
+        retries.clear();
+
+        // The armed wake read guarantees that this returns on new submissions.
+        ring.Enter(1);
+        ring.Reap(handle);
+    }
+
+    FailAll(std::move(ops));
+    FailAll(std::move(retries));
+    retries.clear();
+    for (auto &[key, queue] : streams) {
+        for (auto &op : queue) {
+            Complete(std::move(op), -ECANCELED);
+        }
+    }
+    streams.clear();
+
+    // Cancel everything in flight and wait for the kernel to release the buffers.
+    auto cancel = [&](uint64_t tag) {
+        io_uring_sqe *sqe = ring.NextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = tag;
+        sqe->user_data = CANCEL_TAG;
+    };
+    if (wake_armed) {
+        cancel(WAKE_TAG);
+    }
+    for (size_t slot = 0; slot < slots.size(); ++slot) {
+        if (slots[slot]) {
+            cancel(PollTag(slot));
+            cancel(OperationTag(slot));
+        }
+    }
+    while (inflight > 0 || wake_armed) {
+        ring.Enter(1);
+        ring.Reap(handle);
+        // Operations retried after a stop are failed right away.
+        FailAll(std::move(retries));
+        retries.clear();
+    }
+    // Cancel completions may still be queued, drain them.
+    ring.Enter(0);
+    ring.Reap(handle);
+}
+
+void Reactor::EpollLoop() {
+    static constexpr int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+
+    std::vector<OperationPtr> ops;
+    while (TakePending(ops)) {
+        for (auto &op : ops) {
+            // Keep the submission order of operations on the same fd.
+            auto it = epoll_waiters_.find(op->fd);
+            bool queued = it != epoll_waiters_.end() &&
+                !(op->kind == Operation::WRITE ? it->second.writers : it->second.readers).empty();
+            if (queued || !TryPerform(op)) {
+                Park(std::move(op));
+            }
+        }
+        ops.clear();
+
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowErrno("epoll_wait");
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wake_fd_) {
+                uint64_t value;
+                [[maybe_unused]] auto read_bytes = read(wake_fd_, &value, sizeof(value));
+            } else {
+                RetryParked(events[i].data.fd, events[i].events);
+            }
+        }
+    }
+
+    FailAll(std::move(ops));
+    for (auto &[fd, waiters] : epoll_waiters_) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        for (auto *queue : {&waiters.readers, &waiters.writers}) {
+            for (auto &op : *queue) {
+                Complete(std::move(op), -ECANCELED);
+            }
+        }
+    }
+    epoll_waiters_.clear();
+}
+
+bool Reactor::TryPerform(OperationPtr &op) {
+    if (op->kind != Operation::PREAD) {
+        int flags = fcntl(op->fd, F_GETFL);
+        if (flags >= 0 && !(flags & O_NONBLOCK)) {
+            fcntl(op->fd, F_SETFL, flags | O_NONBLOCK);
+        }
+    }
+
+    ssize_t result = 0;
+    do {
+        switch (op->kind) {
+            case Operation::READ:
+                result = read(op->fd, op->buf, op->len);
+                break;
+            case Operation::WRITE:
+                result = write(op->fd, op->buf, op->len);
+                break;
+            case Operation::PREAD:
+                result = pread(op->fd, op->buf, op->len, op->offset);
+                break;
+        }
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+    }
+    Complete(std::move(op), result < 0 ? -errno : result);
+    return true;
+}
+
+void Reactor::Park(OperationPtr op) {
+    int fd = op->fd;
+    auto &waiters = epoll_waiters_[fd];
+    if (op->kind == Operation::WRITE) {
+        waiters.writers.push_back(std::move(op));
+    } else {
+        waiters.readers.push_back(std::move(op));
+    }
+    UpdateEpollRegistration(fd, waiters);
+}
+
+void Reactor::RetryParked(int fd, uint32_t events) {
+    auto it = epoll_waiters_.find(fd);
+    if (it == epoll_waiters_.end()) {
+        return;
+    }
+    auto &waiters = it->second;
+
+    // Errors and hang-ups are reported by the operations themselves.
+    constexpr uint32_t FAILED = EPOLLERR | EPOLLHUP;
+    auto retry = [this](std::deque<OperationPtr> &queue) {
+        while (!queue.empty() && TryPerform(queue.front())) {
+            queue.pop_front();
+        }
+    };
+    if (events & (EPOLLIN | FAILED)) {
+        retry(waiters.readers);
+    }
+    if (events & (EPOLLOUT | FAILED)) {
+        retry(waiters.writers);
+    }
+
+    UpdateEpollRegistration(fd, waiters);
+}
+
+void Reactor::UpdateEpollRegistration(int fd, EpollWaiters &waiters) {
+    uint32_t wanted = (waiters.readers.empty() ? 0u : uint32_t(EPOLLIN)) |
+                      (waiters.writers.empty() ? 0u : uint32_t(EPOLLOUT));
+    if (wanted == waiters.registered_events) {
+        if (wanted == 0) {
+            epoll_waiters_.erase(fd);
+        }
+        return;
+    }
+
+    if (wanted == 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        epoll_waiters_.erase(fd);
+        return;
+    }
+
+    epoll_event event {};
+    event.events = wanted;
+    event.data.fd = fd;
+    int ctl = (waiters.registered_events == 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(epoll_fd_, ctl, fd, &event) < 0) {
+        // Not pollable (e.g. closed), let the operations report the error.
+        int error = errno;
+        for (auto *queue : {&waiters.readers, &waiters.writers}) {
+            for (auto &op : *queue) {
+                Complete(std::move(op), -error);
+            }
+        }
+        if (waiters.registered_events != 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        }
+        epoll_waiters_.erase(fd);
+        return;
+    }
+    waiters.registered_events = wanted;
+}
+
+}  // namespace exec
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "async/future.h"
+#include "async/promise.h"
+#include "exec/executor.h"
+
+namespace exec {
+
+// Event loop for file, pipe and socket I/O on a dedicated thread, so that
+// I/O-bound tasks don't hold pool workers for the duration of syscalls.
+//
+// Uses io_uring if the kernel allows it, epoll otherwise.
+// With epoll, fds are switched to non-blocking mode and regular files are read
+// on the reactor thread (they are always "ready" for epoll).
+//
+// Reads (writes) on the same pipe or socket complete in submission order.
+// Buffers must stay alive until the returned future is fulfilled.
+// Futures are fulfilled in `executor` if it is set, on the reactor thread otherwise.
+
+class Reactor {
+public:
+    enum class Backend {
+        IO_URING,
+        EPOLL,
+    };
+
+public:
+    explicit Reactor(Backend preferred = Backend::IO_URING);
+
+    // Non-copyable
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Non-movable
+    Reactor(Reactor&&) = delete;
+    Reactor& operator=(Reactor&&) = delete;
+
+    ~Reactor();
+
+    // Operations submitted before `Start` are performed once the loop is started.
+    void Start();
+
+    // Pending operations are failed, in-flight ones are cancelled.
+    void Stop();
+
+    Backend GetBackend() const;
+
+    // Resolved with the number of bytes transferred, 0 on end of file.
+    async::Future<size_t> ReadAsync(int fd, void *buf, size_t len, IExecutor *executor = nullptr);
+    async::Future<size_t> WriteAsync(int fd, const void *buf, size_t len, IExecutor *executor = nullptr);
+    // Positional read, doesn't use or move the file offset.
+    async::Future<size_t> ReadFileAsync(int fd, void *buf, size_t len, off_t offset,
+                                        IExecutor *executor = nullptr);
+
+private:
+    struct Operation {
+        enum Kind {
+            READ,
+            WRITE,
+            PREAD,
+        };
+
+        Kind kind;
+        int fd;
+        void *buf;
+        size_t len;
+        off_t offset;
+        IExecutor *executor;
+        async::Promise<size_t> promise;
+    };
+
+    using OperationPtr = std::unique_ptr<Operation>;
+
+    // Fds waiting for readiness in epoll backend.
+    struct EpollWaiters {
+        std::deque<OperationPtr> readers;
+        std::deque<OperationPtr> writers;
+        uint32_t registered_events {0};
+    };
+
+    struct IoUring;
+
+private:
+    async::Future<size_t> Submit(OperationPtr op);
+    // Moves pending operations to `ops`, returns false once stopped.
+    bool TakePending(std::vector<OperationPtr> &ops);
+    void Wake();
+
+    static void Complete(OperationPtr op, ssize_t result);
+
+    void IoUringLoop();
+    void EpollLoop();
+    static void FailAll(std::vector<OperationPtr> ops);
+    // Returns false if `op` would block.
+    bool TryPerform(OperationPtr &op);
+    void Park(OperationPtr op);
+    void RetryParked(int fd, uint32_t events);
+    void UpdateEpollRegistration(int fd, EpollWaiters &waiters);
+
+private:
+    Backend backend_;
+    int wake_fd_ {-1};
+
+    std::unique_ptr<IoUring> ring_;
+    int epoll_fd_ {-1};
+    std::unordered_map<int, EpollWaiters> epoll_waiters_;
+
+    std::mutex pending_mutex_;
+    std::vector<OperationPtr> pending_;
+    // Guarded by `pending_mutex_`.
+    bool stopped_ {false};
+
+    std::once_flag started_;
+    std::thread loop_;
+};
+
+}  // namespace exec
@@ -1,6 +1,7 @@
 #include <cassert>
 
 #include "exec/thread_pool.h"
+#include "trace/trace.h"
 
 namespace exec {
 
@@ -11,13 +12,11 @@ ThreadPool::ThreadPool(size_t threads) : threads_count_(threads), free_workers_c
 }
 
 void ThreadPool::Start() {
-    if (started_) {
-        return;
-    }
-
-    for (size_t i = 0; i < threads_count_; ++i) {
-        AddWorker();
-    }
+    std::call_once(started_, [this]() {
+        for (size_t i = 0; i < threads_count_; ++i) {
+            AddWorker();
+        }
+    });
 }
 
 ThreadPool::~ThreadPool() {
@@ -27,6 +26,17 @@ ThreadPool::~ThreadPool() {
 void ThreadPool::Submit(Task task) {
     // register new task to be able to wait it done
     // wait_group_.Add(1);
+#ifdef ASYNC_TRACING
+    if (trace::IsEnabled()) {
+        auto flow_id = trace::NextFlowId();
+        trace::Record(trace::SUBMIT, trace::Phase::INSTANT);
+        trace::Record(trace::TASK, trace::Phase::FLOW_START, flow_id);
+        task = [flow_id, task = std::move(task)]() mutable {
+            trace::Scope scope(trace::TASK, flow_id);
+            task();
+        };
+    }
+#endif
     tasks_queue_.Put(std::move(task));
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -29,6 +30,7 @@ public:
 
     ~ThreadPool();
 
+    // Idempotent and thread-safe.
     void Start();
 
     // IExecutor
@@ -48,7 +50,7 @@ protected:
     static void WorkerEntry(ThreadPool *pool);
 
 private:
-    bool started_ {false};
+    std::once_flag started_;
 
     const size_t threads_count_;
     std::vector<WorkerThread> workers_;
@@ -1,8 +1,10 @@
+#include <memory>
 #include <thread>
 
 #include "gtest/gtest.h"
 
 #include "async/async.h"
+#include "async/then.h"
 
 namespace async::tests {
 
@@ -103,4 +105,109 @@ TEST_F(AsyncTest, TestAsyncFullLoadException) {
     ASSERT_THROW(f.TryGet(), std::logic_error);
 }
 
+TEST_F(AsyncTest, TestDeferred) {
+    bool called = false;
+    std::thread::id called_from;
+    auto f = Async(Launch::deferred, [&]() {
+        called = true;
+        called_from = std::this_thread::get_id();
+        return TestInLoop(ITERATIONS, false, false);
+    });
+
+    // Must not be run before `Get`.
+    ASSERT_FALSE(f.TryGet().has_value());
+    ASSERT_FALSE(called);
+
+    ASSERT_EQ(f.Get(), ITERATIONS);
+    ASSERT_TRUE(called);
+    ASSERT_EQ(called_from, std::this_thread::get_id());
+}
+
+TEST_F(AsyncTest, TestDeferredThen) {
+    bool called = false;
+    auto f = Async(Launch::deferred, [&called]() { called = true; return ITERATIONS; });
+    ASSERT_FALSE(called);
+
+    auto composed = std::move(f) | Then([](int value) { return value * 2; });
+    ASSERT_TRUE(called);
+
+    auto res = composed.TryGet();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), ITERATIONS * 2);
+}
+
+TEST_F(AsyncTest, TestDeferredException) {
+    auto f = Async(Launch::deferred, TestInLoop, ITERATIONS, false, true);
+    ASSERT_THROW(f.Get(), std::logic_error);
+}
+
+TEST_F(AsyncTest, TestDeferredNotRun) {
+    auto captured = std::make_shared<int>(ITERATIONS);
+    std::weak_ptr<int> observer = captured;
+    {
+        auto f = Async(Launch::deferred, [captured = std::move(captured)]() { return *captured; });
+    }
+    // Dropping the future must release the task and everything it captured.
+    ASSERT_TRUE(observer.expired());
+}
+
+TEST_F(AsyncTest, TestAdaptiveInlinesCheapTasks) {
+    auto cheap = [](int value) { return value + 1; };
+    // One call site for the warm-up and the checked call.
+    const LaunchSite site(Launch::adaptive);
+    for (int i = 0; i < 16; ++i) {
+        ASSERT_EQ(Async(site, cheap, i).Get(), i + 1);
+    }
+
+    // Cost is known by now, must be synchronous.
+    auto f = Async(site, cheap, ITERATIONS);
+    auto res = f.TryGet();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), ITERATIONS + 1);
+}
+
+TEST_F(AsyncTest, TestAdaptiveEnqueuesExpensiveTasks) {
+    auto expensive = [](int iterations) { return TestInLoop(iterations, true, false); };
+    const LaunchSite site(Launch::adaptive);
+    Async(site, expensive, ITERATIONS).Get();
+
+    ASSERT_FALSE(_detail::_cost_estimates<decltype(expensive)>.At(site.location).IsCheap());
+    ASSERT_EQ(Async(site, expensive, ITERATIONS).Get(), ITERATIONS);
+}
+
+TEST_F(AsyncTest, TestAdaptiveEstimatesPerCallSite) {
+    // The same function pointer, cheap at one site and expensive at the other.
+    const LaunchSite cheap(Launch::adaptive);
+    const LaunchSite expensive(Launch::adaptive);
+    ASSERT_EQ(Async(cheap, TestInLoop, 1, false, false).Get(), 1);
+    ASSERT_EQ(Async(expensive, TestInLoop, ITERATIONS, true, false).Get(), ITERATIONS);
+
+    auto &estimates = _detail::_cost_estimates<decltype(&TestInLoop)>;
+    ASSERT_TRUE(estimates.At(cheap.location).IsCheap());
+    ASSERT_FALSE(estimates.At(expensive.location).IsCheap());
+}
+
+TEST_F(AsyncTest, TestExecutor) {
+    exec::ThreadPool pool(2);
+    pool.Start();
+
+    auto f = Async(pool, []() {
+        return exec::ThreadPool::Current();
+    });
+    auto composed = std::move(f) | Then([](exec::ThreadPool *producer) {
+        // Continuation must be scheduled in the same pool.
+        return producer == exec::ThreadPool::Current();
+    });
+
+    ASSERT_TRUE(composed.Get());
+}
+
+TEST_F(AsyncTest, TestExecutorException) {
+    exec::ThreadPool pool(1);
+    pool.Start();
+
+    auto f = Async(pool, TestInLoop, ITERATIONS, false, true);
+    ASSERT_THROW(f.Get(), std::logic_error);
+}
+
 }   // namespace async::tests
@@ -0,0 +1,158 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "async/cache.h"
+#include "async/then.h"
+
+namespace async::tests {
+
+class CacheTest : public ::testing::Test {
+public:
+    static constexpr int ITERATIONS = 1000;
+
+    using Cache = AsyncCache<int, std::string>;
+};
+
+TEST_F(CacheTest, TestCoalescesMisses) {
+    Cache cache(ITERATIONS);
+    Promise<std::string> p;
+    int calls = 0;
+    auto compute = [&]() {
+        ++calls;
+        return p.MakeFuture();
+    };
+
+    auto first = cache.GetOrCompute(1, compute);
+    auto second = cache.GetOrCompute(1, compute);
+    ASSERT_EQ(calls, 1);
+    ASSERT_FALSE(first.TryGet().has_value());
+
+    std::move(p).SetValue(std::string("one"));
+    ASSERT_EQ(first.Get(), "one");
+    ASSERT_EQ(second.Get(), "one");
+
+    // Ready value is returned without computing.
+    auto third = cache.GetOrCompute(1, compute);
+    ASSERT_EQ(third.TryGet().value(), "one");
+    ASSERT_EQ(calls, 1);
+
+    auto stats = cache.GetStats();
+    ASSERT_EQ(stats.misses, 1u);
+    ASSERT_EQ(stats.coalesced, 1u);
+    ASSERT_EQ(stats.hits, 1u);
+}
+
+TEST_F(CacheTest, TestConcurrentMissesComputeOnce) {
+    Cache cache(ITERATIONS);
+    std::atomic<int> calls {0};
+
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(8);
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            results[i] = cache.GetOrCompute(7, [&calls]() {
+                calls.fetch_add(1);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                return std::string("seven");
+            }).Get();
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    ASSERT_EQ(calls.load(), 1);
+    for (auto &result : results) {
+        ASSERT_EQ(result, "seven");
+    }
+}
+
+TEST_F(CacheTest, TestFailureNotCached) {
+    Cache cache(ITERATIONS);
+    auto fail = []() -> Future<std::string> {
+        throw std::runtime_error("unavailable");
+    };
+
+    ASSERT_THROW(cache.GetOrCompute(1, fail).Get(), std::runtime_error);
+    ASSERT_EQ(cache.Size(), 0u);
+
+    auto f = cache.GetOrCompute(1, []() { return Future<std::string>::MakeReady("one"); });
+    ASSERT_EQ(f.Get(), "one");
+    ASSERT_EQ(cache.GetStats().misses, 2u);
+}
+
+TEST_F(CacheTest, TestEviction) {
+    Cache cache(Cache::SHARDS * 4);
+    for (int i = 0; i < ITERATIONS; ++i) {
+        cache.GetOrCompute(i, [i]() { return Future<std::string>::MakeReady(std::to_string(i)); }).Get();
+    }
+
+    ASSERT_EQ(cache.Size(), Cache::SHARDS * 4);
+    ASSERT_EQ(cache.GetStats().evictions, ITERATIONS - Cache::SHARDS * 4);
+}
+
+TEST_F(CacheTest, TestRecentlyUsedSurvives) {
+    Cache cache(Cache::SHARDS * 4);
+    auto make = [](int i) {
+        return [i]() { return Future<std::string>::MakeReady(std::to_string(i)); };
+    };
+
+    cache.GetOrCompute(0, make(0)).Get();
+    for (int i = 1; i < ITERATIONS; ++i) {
+        // Hit on the hot key sets its reference bit again.
+        cache.GetOrCompute(0, make(0)).Get();
+        cache.GetOrCompute(i, make(i)).Get();
+    }
+
+    ASSERT_EQ(cache.GetStats().misses, static_cast<uint64_t>(ITERATIONS));
+}
+
+TEST_F(CacheTest, TestTtl) {
+    Cache cache(ITERATIONS, std::chrono::milliseconds(1));
+    int calls = 0;
+    auto compute = [&calls]() {
+        ++calls;
+        return Future<std::string>::MakeReady("one");
+    };
+
+    cache.GetOrCompute(1, compute).Get();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    cache.GetOrCompute(1, compute).Get();
+
+    ASSERT_EQ(calls, 2);
+    ASSERT_EQ(cache.GetStats().expirations, 1u);
+}
+
+TEST_F(CacheTest, TestPurgeTimer) {
+    Cache cache(ITERATIONS, std::chrono::milliseconds(1), std::chrono::milliseconds(1));
+    for (int i = 0; i < 10; ++i) {
+        cache.GetOrCompute(i, []() { return Future<std::string>::MakeReady("value"); }).Get();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (cache.Size() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(cache.Size(), 0u);
+}
+
+TEST_F(CacheTest, TestInvalidateInFlight) {
+    Cache cache(ITERATIONS);
+    Promise<std::string> p;
+
+    auto f = cache.GetOrCompute(1, [&p]() { return p.MakeFuture(); });
+    cache.Invalidate(1);
+    std::move(p).SetValue(std::string("stale"));
+
+    // Waiters still get the result, it is just not cached.
+    ASSERT_EQ(f.Get(), "stale");
+    ASSERT_EQ(cache.Size(), 0u);
+}
+
+}   // namespace async::tests
@@ -0,0 +1,125 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "async/channel.h"
+#include "async/then.h"
+#include "exec/thread_pool.h"
+
+namespace async::tests {
+
+class ChannelTest : public ::testing::Test {
+public:
+    static constexpr int ITERATIONS = 1000;
+};
+
+TEST_F(ChannelTest, TestSendThenRecv) {
+    Channel<int> channel;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        // Unbounded channel never applies backpressure.
+        ASSERT_TRUE(channel.Send(i).TryGet().has_value());
+    }
+    for (int i = 0; i < ITERATIONS; ++i) {
+        auto value = channel.Recv().TryGet();
+        ASSERT_TRUE(value.has_value());
+        ASSERT_EQ(value.value(), i);
+    }
+}
+
+TEST_F(ChannelTest, TestRecvThenSend) {
+    Channel<int> channel;
+    auto received = channel.Recv();
+    ASSERT_FALSE(received.TryGet().has_value());
+
+    ASSERT_TRUE(channel.Send(ITERATIONS).TryGet().has_value());
+
+    auto value = received.TryGet();
+    ASSERT_TRUE(value.has_value());
+    ASSERT_EQ(value.value(), ITERATIONS);
+}
+
+TEST_F(ChannelTest, TestBackpressure) {
+    Channel<int> channel(2);
+    ASSERT_TRUE(channel.Send(1).TryGet().has_value());
+    ASSERT_TRUE(channel.Send(2).TryGet().has_value());
+
+    auto sent = channel.Send(3);
+    ASSERT_FALSE(sent.TryGet().has_value());
+
+    ASSERT_EQ(channel.Recv().Get(), 1);
+    // Slot is freed by `Recv`.
+    ASSERT_TRUE(sent.TryGet().has_value());
+
+    ASSERT_EQ(channel.Recv().Get(), 2);
+    ASSERT_EQ(channel.Recv().Get(), 3);
+}
+
+TEST_F(ChannelTest, TestClose) {
+    Channel<int> channel(1);
+    ASSERT_TRUE(channel.Send(1).TryGet().has_value());
+    auto pending = channel.Send(2);
+
+    channel.Close();
+
+    ASSERT_THROW(pending.Get(), std::runtime_error);
+    ASSERT_THROW(channel.Send(3).Get(), std::runtime_error);
+
+    // Buffered values are still delivered.
+    ASSERT_EQ(channel.Recv().Get(), 1);
+    ASSERT_EQ(channel.Recv().Get(), std::nullopt);
+}
+
+TEST_F(ChannelTest, TestCloseWakesReceivers) {
+    Channel<int> channel;
+    auto received = channel.Recv();
+
+    channel.Close();
+
+    auto value = received.TryGet();
+    ASSERT_TRUE(value.has_value());
+    ASSERT_EQ(value.value(), std::nullopt);
+}
+
+// Forwards doubled values from `in` to `out` without dedicating a thread to the stage.
+static void Transform(Channel<int> &in, Channel<int> &out) {
+    auto done = in.Recv() | Then([&in, &out](std::optional<int> value) {
+        if (!value.has_value()) {
+            out.Close();
+            return Unit{};
+        }
+        auto sent = out.Send(value.value() * 2) | Then([&in, &out](Unit) {
+            Transform(in, out);
+            return Unit{};
+        });
+        return Unit{};
+    });
+}
+
+TEST_F(ChannelTest, TestPipeline) {
+    exec::ThreadPool pool(2);
+    pool.Start();
+
+    Channel<int> source(4, &pool);
+    Channel<int> sink(4, &pool);
+    Transform(source, sink);
+
+    std::jthread producer([&source]() {
+        for (int i = 0; i < ITERATIONS; ++i) {
+            source.Send(i).Get();
+        }
+        source.Close();
+    });
+
+    long long sum = 0;
+    int count = 0;
+    while (auto value = sink.Recv().Get()) {
+        sum += value.value();
+        ++count;
+    }
+
+    ASSERT_EQ(count, ITERATIONS);
+    ASSERT_EQ(sum, static_cast<long long>(ITERATIONS) * (ITERATIONS - 1));
+}
+
+}   // namespace async::tests
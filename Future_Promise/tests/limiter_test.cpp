@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "exec/limiter.h"
+#include "exec/thread_pool.h"
+
+namespace exec::tests {
+
+// Runs tasks only when asked to.
+class ManualExecutor : public IExecutor {
+public:
+    void Submit(Task task) override {
+        if (rejections > 0) {
+            --rejections;
+            throw std::runtime_error("executor is full");
+        }
+        tasks.push_back(std::move(task));
+    }
+
+    void RunOne() {
+        auto task = std::move(tasks.front());
+        tasks.pop_front();
+        task();
+    }
+
+    void RunAll() {
+        while (!tasks.empty()) {
+            RunOne();
+        }
+    }
+
+public:
+    std::deque<Task> tasks;
+    // Submissions to refuse.
+    int rejections {0};
+};
+
+class LimiterTest : public ::testing::Test {
+public:
+    static constexpr int ITERATIONS = 1000;
+};
+
+TEST_F(LimiterTest, TestCapsConcurrency) {
+    ThreadPool pool(4);
+    pool.Start();
+
+    std::atomic<int> running {0};
+    std::atomic<int> max_running {0};
+    std::atomic<int> done {0};
+    {
+        Limiter limiter(pool, 2, ITERATIONS);
+        for (int i = 0; i < ITERATIONS / 10; ++i) {
+            limiter.Submit([&]() {
+                int now = running.fetch_add(1) + 1;
+                int max = max_running.load();
+                while (now > max && !max_running.compare_exchange_weak(max, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                running.fetch_sub(1);
+                done.fetch_add(1);
+            });
+        }
+        // Destructor waits for all tasks.
+    }
+
+    ASSERT_EQ(done.load(), ITERATIONS / 10);
+    ASSERT_LE(max_running.load(), 2);
+}
+
+TEST_F(LimiterTest, TestQueuedInOrder) {
+    ManualExecutor executor;
+    Limiter limiter(executor, 1, 10);
+
+    std::vector<int> order;
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(limiter.TrySubmit([&order, i]() { order.push_back(i); }), Limiter::Admission::ACCEPTED);
+    }
+    ASSERT_EQ(limiter.Running(), 1u);
+    ASSERT_EQ(limiter.Waiting(), 4u);
+    ASSERT_EQ(executor.tasks.size(), 1u);
+
+    // Each finished task starts the next one.
+    executor.RunAll();
+    ASSERT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+    ASSERT_EQ(limiter.Running(), 0u);
+    ASSERT_EQ(limiter.Waiting(), 0u);
+}
+
+TEST_F(LimiterTest, TestShedByPriority) {
+    ManualExecutor executor;
+    Limiter limiter(executor, 1, 10);
+    auto noop = []() {};
+
+    ASSERT_EQ(limiter.TrySubmit(noop), Limiter::Admission::ACCEPTED);
+
+    // Low priority fills half of the queue.
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(limiter.TrySubmit(noop, Limiter::Priority::LOW), Limiter::Admission::ACCEPTED);
+    }
+    ASSERT_EQ(limiter.TrySubmit(noop, Limiter::Priority::LOW), Limiter::Admission::SHED);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(limiter.TrySubmit(noop), Limiter::Admission::ACCEPTED);
+    }
+    ASSERT_EQ(limiter.TrySubmit(noop), Limiter::Admission::SHED);
+
+    ASSERT_EQ(limiter.TrySubmit(noop, Limiter::Priority::HIGH), Limiter::Admission::ACCEPTED);
+    ASSERT_EQ(limiter.TrySubmit(noop, Limiter::Priority::HIGH), Limiter::Admission::QUEUE_FULL);
+
+    try {
+        limiter.Submit(noop);
+        FAIL();
+    } catch (const Limiter::RejectedError &e) {
+        ASSERT_EQ(e.Reason(), Limiter::Admission::QUEUE_FULL);
+    }
+
+    executor.RunAll();
+    ASSERT_EQ(limiter.TrySubmit(noop, Limiter::Priority::LOW), Limiter::Admission::ACCEPTED);
+    executor.RunAll();
+}
+
+TEST_F(LimiterTest, TestExecutorRejects) {
+    ManualExecutor executor;
+    Limiter limiter(executor, 1, 10);
+
+    // Submitted directly: the submitter gets the error.
+    executor.rejections = 1;
+    ASSERT_THROW(limiter.Submit([]() {}), std::runtime_error);
+    ASSERT_EQ(limiter.Running(), 0u);
+
+    std::vector<int> order;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(limiter.TrySubmit([&order, i]() { order.push_back(i); }), Limiter::Admission::ACCEPTED);
+    }
+    ASSERT_EQ(limiter.Waiting(), 2u);
+
+    // Started from the queue: the task is dropped and the next one starts.
+    executor.rejections = 1;
+    executor.RunAll();
+    ASSERT_EQ(order, (std::vector<int>{0, 2}));
+    ASSERT_EQ(limiter.Dropped(), 1u);
+    ASSERT_EQ(limiter.Running(), 0u);
+    ASSERT_EQ(limiter.Waiting(), 0u);
+}
+
+TEST_F(LimiterTest, TestAdaptiveDecreasesOnSlowTasks) {
+    ManualExecutor executor;
+    Limiter limiter(executor, 8, ITERATIONS);
+    limiter.SetAdaptive(1, 8);
+
+    auto noop = []() {};
+    // Fast tasks establish the baseline latency.
+    for (int i = 0; i < 16; ++i) {
+        limiter.Submit(noop);
+        executor.RunAll();
+    }
+
+    // Tasks stuck in the downstream.
+    for (int i = 0; i < 16; ++i) {
+        limiter.Submit(noop);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    executor.RunAll();
+
+    ASSERT_LT(limiter.Limit(), 8u);
+}
+
+TEST_F(LimiterTest, TestAdaptiveIncreasesWhenSaturated) {
+    ThreadPool pool(8);
+    pool.Start();
+
+    Limiter limiter(pool, 2, ITERATIONS);
+    limiter.SetAdaptive(1, 8);
+
+    // Downstream with steady latency: queueing is the only bottleneck.
+    for (int i = 0; i < 100; ++i) {
+        limiter.Submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+    }
+    while (limiter.Waiting() > 0 || limiter.Running() > 0) {
+        std::this_thread::yield();
+    }
+
+    ASSERT_GT(limiter.Limit(), 2u);
+}
+
+}   // namespace exec::tests
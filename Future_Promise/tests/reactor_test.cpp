@@ -0,0 +1,170 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "async/then.h"
+#include "exec/reactor.h"
+#include "exec/thread_pool.h"
+
+namespace exec::tests {
+
+class ReactorTest : public ::testing::TestWithParam<Reactor::Backend> {
+public:
+    static constexpr int ITERATIONS = 1000;
+
+    void SetUp() override {
+        ASSERT_EQ(pipe(pipe_), 0);
+    }
+
+    void TearDown() override {
+        close(pipe_[0]);
+        close(pipe_[1]);
+    }
+
+protected:
+    int pipe_[2];
+};
+
+TEST_P(ReactorTest, TestPipeWriteThenRead) {
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    std::string message = "hello";
+    ASSERT_EQ(reactor.WriteAsync(pipe_[1], message.data(), message.size()).Get(), message.size());
+
+    char buf[16];
+    ASSERT_EQ(reactor.ReadAsync(pipe_[0], buf, sizeof(buf)).Get(), message.size());
+    ASSERT_EQ(std::string(buf, message.size()), message);
+}
+
+TEST_P(ReactorTest, TestReadWaitsForData) {
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    char buf[16];
+    auto read = reactor.ReadAsync(pipe_[0], buf, sizeof(buf));
+    ASSERT_FALSE(read.TryGet().has_value());
+
+    ASSERT_EQ(write(pipe_[1], "x", 1), 1);
+    ASSERT_EQ(read.Get(), 1u);
+    ASSERT_EQ(buf[0], 'x');
+}
+
+TEST_P(ReactorTest, TestReadEndOfFile) {
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    char buf[16];
+    auto read = reactor.ReadAsync(pipe_[0], buf, sizeof(buf));
+    close(pipe_[1]);
+    pipe_[1] = -1;
+
+    ASSERT_EQ(read.Get(), 0u);
+}
+
+TEST_P(ReactorTest, TestSubmitBeforeStart) {
+    Reactor reactor(GetParam());
+
+    char buf[16];
+    auto read = reactor.ReadAsync(pipe_[0], buf, sizeof(buf));
+    ASSERT_EQ(write(pipe_[1], "x", 1), 1);
+
+    reactor.Start();
+    ASSERT_EQ(read.Get(), 1u);
+}
+
+TEST_P(ReactorTest, TestSocketPairPingPong) {
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    std::vector<int> received(ITERATIONS);
+    std::vector<async::Future<size_t>> reads;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        reads.push_back(reactor.ReadAsync(sockets[1], &received[i], sizeof(int)));
+    }
+    for (int i = 0; i < ITERATIONS; ++i) {
+        ASSERT_EQ(reactor.WriteAsync(sockets[0], &i, sizeof(int)).Get(), sizeof(int));
+    }
+    // Reads on the same fd complete in submission order.
+    for (int i = 0; i < ITERATIONS; ++i) {
+        ASSERT_EQ(reads[i].Get(), sizeof(int));
+        ASSERT_EQ(received[i], i);
+    }
+
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST_P(ReactorTest, TestReadFileAtOffset) {
+    char path[] = "/tmp/reactor_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+
+    std::string content = "hello, reactor";
+    ASSERT_EQ(write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    char buf[16];
+    ASSERT_EQ(reactor.ReadFileAsync(fd, buf, sizeof(buf), 7).Get(), content.size() - 7);
+    ASSERT_EQ(std::string(buf, content.size() - 7), "reactor");
+    // File offset is left at the end of the written content.
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), static_cast<off_t>(content.size()));
+
+    close(fd);
+}
+
+TEST_P(ReactorTest, TestCompletesInExecutor) {
+    ThreadPool pool(1);
+    pool.Start();
+
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    char buf[16];
+    auto in_pool = reactor.ReadAsync(pipe_[0], buf, sizeof(buf), &pool) |
+        async::Then([&pool](size_t) { return ThreadPool::Current() == &pool; });
+    ASSERT_EQ(write(pipe_[1], "x", 1), 1);
+
+    ASSERT_TRUE(in_pool.Get());
+}
+
+TEST_P(ReactorTest, TestError) {
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    char buf[16];
+    // Write end of a pipe is not readable.
+    ASSERT_THROW(reactor.ReadAsync(pipe_[1], buf, sizeof(buf)).Get(), std::system_error);
+}
+
+TEST_P(ReactorTest, TestStopCancelsPending) {
+    Reactor reactor(GetParam());
+    reactor.Start();
+
+    char buf[16];
+    auto read = reactor.ReadAsync(pipe_[0], buf, sizeof(buf));
+    reactor.Stop();
+    ASSERT_THROW(read.Get(), std::system_error);
+
+    // Submissions after stop fail immediately.
+    ASSERT_THROW(reactor.ReadAsync(pipe_[0], buf, sizeof(buf)).Get(), std::system_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, ReactorTest,
+                         ::testing::Values(Reactor::Backend::IO_URING, Reactor::Backend::EPOLL));
+
+}   // namespace exec::tests
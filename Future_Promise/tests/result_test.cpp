@@ -0,0 +1,154 @@
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "async/async.h"
+#include "async/then.h"
+
+namespace async::tests {
+
+class ResultTest : public ::testing::Test {
+public:
+    static constexpr int ITERATIONS = 1000000;
+
+    using IntResult = Result<int, std::string>;
+};
+
+static ResultTest::IntResult Validate(int value) {
+    if (value < 0) {
+        return Fail(std::string("negative"));
+    }
+    return value;
+}
+
+TEST_F(ResultTest, TestThenMapsValue) {
+    Promise<IntResult> p;
+    auto composed = p.MakeFuture() |
+        Then([](int value) { return value * 2.0; }) |
+        Then([](double value) { return value + 1.0; });
+    static_assert(std::is_same_v<decltype(composed), Future<Result<double, std::string>>>);
+
+    std::move(p).SetValue(IntResult(1));
+
+    auto result = composed.Get();
+    ASSERT_TRUE(result.HasValue());
+    ASSERT_DOUBLE_EQ(result.Value(), 3.0);
+}
+
+TEST_F(ResultTest, TestThenPassesErrorThrough) {
+    Promise<IntResult> p;
+    int calls = 0;
+    auto composed = p.MakeFuture() |
+        Then([&calls](int value) { ++calls; return value * 2.0; }) |
+        Then([&calls](double value) { ++calls; return value + 1.0; });
+
+    std::move(p).SetValue(IntResult(Fail(std::string("miss"))));
+
+    auto result = composed.Get();
+    ASSERT_FALSE(result.HasValue());
+    ASSERT_EQ(result.Error(), "miss");
+    ASSERT_EQ(calls, 0);
+}
+
+TEST_F(ResultTest, TestThenReturningResult) {
+    Promise<IntResult> p;
+    auto composed = p.MakeFuture() |
+        Then([](int value) { return Validate(value - 2); }) |
+        Then([](int value) { return value * 2; });
+    static_assert(std::is_same_v<decltype(composed), Future<IntResult>>);
+
+    std::move(p).SetValue(IntResult(1));
+
+    auto result = composed.Get();
+    ASSERT_FALSE(result.HasValue());
+    ASSERT_EQ(result.Error(), "negative");
+}
+
+TEST_F(ResultTest, TestThenOnWholeResult) {
+    Promise<IntResult> p;
+    auto composed = p.MakeFuture() |
+        Then([](IntResult result) { return result.HasValue(); });
+    static_assert(std::is_same_v<decltype(composed), Future<bool>>);
+
+    std::move(p).SetValue(IntResult(Fail(std::string("miss"))));
+
+    ASSERT_FALSE(composed.Get());
+}
+
+TEST_F(ResultTest, TestRecover) {
+    Promise<IntResult> p;
+    auto composed = p.MakeFuture() |
+        Recover([](const std::string &error) { return static_cast<int>(error.size()); }) |
+        Then([](int value) { return value + 1; });
+
+    std::move(p).SetValue(IntResult(Fail(std::string("miss"))));
+
+    auto result = composed.Get();
+    ASSERT_TRUE(result.HasValue());
+    ASSERT_EQ(result.Value(), 5);
+}
+
+TEST_F(ResultTest, TestRecoverKeepsValue) {
+    Promise<IntResult> p;
+    auto composed = p.MakeFuture() |
+        Recover([](const std::string &) { return 0; });
+
+    std::move(p).SetValue(IntResult(7));
+
+    auto result = composed.Get();
+    ASSERT_TRUE(result.HasValue());
+    ASSERT_EQ(result.Value(), 7);
+}
+
+TEST_F(ResultTest, TestMapError) {
+    Promise<IntResult> p;
+    auto composed = p.MakeFuture() |
+        MapError([](const std::string &error) { return static_cast<int>(error.size()); });
+    static_assert(std::is_same_v<decltype(composed), Future<Result<int, int>>>);
+
+    std::move(p).SetValue(IntResult(Fail(std::string("miss"))));
+
+    auto result = composed.Get();
+    ASSERT_FALSE(result.HasValue());
+    ASSERT_EQ(result.Error(), 4);
+}
+
+TEST_F(ResultTest, TestAsyncResultPipeline) {
+    auto composed = Async([](int value) { return Validate(value); }, ITERATIONS) |
+        Then([](int value) { return value / 2; });
+
+    auto result = composed.Get();
+    ASSERT_TRUE(result.HasValue());
+    ASSERT_EQ(result.Value(), ITERATIONS / 2);
+}
+
+TEST_F(ResultTest, TestGetResultReturnsException) {
+    Promise<int> p;
+    auto f = p.MakeFuture();
+
+    ASSERT_FALSE(f.TryGetResult().has_value());
+
+    try {
+        throw std::logic_error("");
+    } catch(...) {
+        std::move(p).SetException(std::current_exception());
+    }
+
+    auto result = f.GetResult();
+    ASSERT_FALSE(result.HasValue());
+    ASSERT_THROW(std::rethrow_exception(result.Error()), std::logic_error);
+}
+
+TEST_F(ResultTest, TestTryGetResultReturnsValue) {
+    Promise<int> p;
+    auto f = p.MakeFuture();
+
+    std::move(p).SetValue(ITERATIONS);
+
+    auto result = f.TryGetResult();
+    ASSERT_TRUE(result.has_value());
+    ASSERT_TRUE(result.value().HasValue());
+    ASSERT_EQ(result.value().Value(), ITERATIONS);
+}
+
+}   // namespace async::tests
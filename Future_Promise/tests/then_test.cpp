@@ -48,6 +48,15 @@ TEST_F(ThenTest, TestSimpleThen) {
     ASSERT_DOUBLE_EQ(result.value(), 2.0);
 }
 
+TEST_F(ThenTest, TestReadyThen) {
+    auto composed = Async(Launch::sync, TestInLoop, ITERATIONS, false, false) |
+        Then([](int value) { return value * 2.0; });
+
+    auto result = composed.TryGet();
+    ASSERT_TRUE(result.has_value());
+    ASSERT_DOUBLE_EQ(result.value(), ITERATIONS * 2.0);
+}
+
 TEST_F(ThenTest, TestAsyncThen) {
     auto f = Async(TestInLoop, ITERATIONS, true, false);
     auto composed = (f & Then([](int value) { return value * 4.0; })) |
@@ -87,4 +96,76 @@ TEST_F(ThenTest, TestAsyncThenException) {
     ASSERT_EQ(f.Get(), ITERATIONS);
 }
 
+TEST_F(ThenTest, TestThenFlattens) {
+    Promise<int> p;
+    Promise<double> inner;
+    auto inner_future = inner.MakeFuture();
+    auto composed = p.MakeFuture() | Then([&inner_future](int) { return std::move(inner_future); });
+    static_assert(std::is_same_v<decltype(composed), Future<double>>);
+
+    std::move(p).SetValue(1);
+    ASSERT_FALSE(composed.TryGet().has_value());
+
+    std::move(inner).SetValue(2.0);
+
+    auto result = composed.TryGet();
+    ASSERT_TRUE(result.has_value());
+    ASSERT_DOUBLE_EQ(result.value(), 2.0);
+}
+
+TEST_F(ThenTest, TestAsyncThenFlattens) {
+    auto composed = Async(TestInLoop, ITERATIONS, true, false) |
+        Then([](int value) { return Async(TestInLoop, value * 2, true, false); }) |
+        Then([](int value) { return value / 2.0; });
+
+    ASSERT_DOUBLE_EQ(composed.Get(), ITERATIONS);
+}
+
+TEST_F(ThenTest, TestThenFlattensException) {
+    Promise<int> p;
+    Promise<double> inner;
+    auto inner_future = inner.MakeFuture();
+    auto composed = p.MakeFuture() | Then([&inner_future](int) { return std::move(inner_future); });
+
+    std::move(p).SetValue(1);
+    ASSERT_FALSE(composed.TryGet().has_value());
+
+    try {
+        throw std::logic_error("");
+    } catch(...) {
+        std::move(inner).SetException(std::current_exception());
+    }
+
+    ASSERT_THROW(composed.TryGet(), std::logic_error);
+}
+
+TEST_F(ThenTest, TestFlatten) {
+    Promise<Future<int>> p;
+    Promise<int> inner;
+    auto flat = p.MakeFuture() | Flatten();
+    static_assert(std::is_same_v<decltype(flat), Future<int>>);
+
+    std::move(p).SetValue(inner.MakeFuture());
+    ASSERT_FALSE(flat.TryGet().has_value());
+
+    std::move(inner).SetValue(ITERATIONS);
+
+    auto result = flat.TryGet();
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result.value(), ITERATIONS);
+}
+
+TEST_F(ThenTest, TestFlattenException) {
+    Promise<Future<int>> p;
+    auto flat = p.MakeFuture() | Flatten();
+
+    try {
+        throw std::logic_error("");
+    } catch(...) {
+        std::move(p).SetException(std::current_exception());
+    }
+
+    ASSERT_THROW(flat.TryGet(), std::logic_error);
+}
+
 }   // namespace async::tests
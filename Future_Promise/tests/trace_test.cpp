@@ -0,0 +1,91 @@
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "async/async.h"
+#include "async/then.h"
+#include "trace/trace.h"
+
+namespace async::tests {
+
+class TraceTest : public ::testing::Test {
+public:
+    void SetUp() override {
+        trace::Clear();
+    }
+
+    void TearDown() override {
+        trace::Disable();
+        trace::Clear();
+    }
+
+    static std::string Export() {
+        std::stringstream out;
+        trace::WriteChromeJson(out);
+        return out.str();
+    }
+
+    static size_t Count(const std::string &haystack, const std::string &needle) {
+        size_t count = 0;
+        for (auto pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) {
+            ++count;
+        }
+        return count;
+    }
+};
+
+TEST_F(TraceTest, TestDisabledRecordsNothing) {
+    trace::Record("event", trace::Phase::INSTANT);
+    {
+        trace::Scope scope("scope");
+    }
+
+    ASSERT_EQ(Export(), "{\"traceEvents\":[],\"displayTimeUnit\":\"ns\"}\n");
+}
+
+TEST_F(TraceTest, TestExport) {
+    trace::Enable();
+    auto flow_id = trace::NextFlowId();
+    trace::Record("producer", trace::Phase::FLOW_START, flow_id);
+    {
+        trace::Scope scope("producer", flow_id);
+    }
+
+    auto json = Export();
+    ASSERT_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+    ASSERT_EQ(Count(json, "\"name\":\"producer\""), 4);
+    ASSERT_EQ(Count(json, "\"ph\":\"s\",\"ts\""), 1);
+    ASSERT_EQ(Count(json, "\"ph\":\"B\""), 1);
+    ASSERT_EQ(Count(json, "\"ph\":\"E\""), 1);
+    ASSERT_EQ(Count(json, "\"id\":" + std::to_string(flow_id) + ",\"bp\":\"e\""), 1);
+}
+
+TEST_F(TraceTest, TestRingBufferKeepsLatestEvents) {
+    trace::Enable();
+    for (int i = 0; i < (1 << 16) + 10; ++i) {
+        trace::Record("event", trace::Phase::INSTANT);
+    }
+
+    ASSERT_EQ(Count(Export(), "\"name\":\"event\""), 1 << 16);
+}
+
+#ifdef ASYNC_TRACING
+TEST_F(TraceTest, TestTaskAndContinuationEvents) {
+    exec::ThreadPool pool(1);
+    pool.Start();
+
+    trace::Enable();
+    auto f = Async(pool, []() { return 1; }) | Then([](int value) { return value + 1; });
+    ASSERT_EQ(f.Get(), 2);
+    pool.Stop();
+
+    auto json = Export();
+    ASSERT_EQ(Count(json, "\"name\":\"submit\""), 2);
+    ASSERT_EQ(Count(json, "\"name\":\"task\",\"cat\":\"async\",\"ph\":\"B\""), 2);
+    ASSERT_GE(Count(json, "\"name\":\"fulfil\""), 2);
+    ASSERT_GE(Count(json, "\"name\":\"continuation\",\"cat\":\"async\",\"ph\":\"f\""), 1);
+}
+#endif
+
+}   // namespace async::tests
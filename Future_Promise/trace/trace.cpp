@@ -0,0 +1,153 @@
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace/trace.h"
+
+namespace trace {
+
+namespace _detail {
+
+std::atomic<bool> _enabled {false};
+
+}   // namespace _detail
+
+namespace {
+
+// Single-producer ring buffer owned by one thread.
+// Only the owner writes, `head_` publishes written events to readers.
+class ThreadBuffer {
+public:
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    explicit ThreadBuffer(uint32_t tid) : tid_(tid) {}
+
+    void Push(const Event &event) {
+        auto head = head_.load(std::memory_order_relaxed);
+        events_[head & (CAPACITY - 1)] = event;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    template <typename F>
+    void ForEach(F &&f) const {
+        auto head = head_.load(std::memory_order_acquire);
+        auto begin = (head > CAPACITY) ? head - CAPACITY : 0;
+        for (auto i = begin; i < head; ++i) {
+            f(events_[i & (CAPACITY - 1)]);
+        }
+    }
+
+    void Clear() {
+        head_.store(0, std::memory_order_release);
+    }
+
+    uint32_t Tid() const {
+        return tid_;
+    }
+
+private:
+    const uint32_t tid_;
+    std::atomic<uint64_t> head_ {0};
+    std::array<Event, CAPACITY> events_;
+};
+
+// Buffers are never freed so that events of exited threads can still be exported.
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+std::atomic<uint64_t> next_flow_id {1};
+
+const auto trace_start = std::chrono::steady_clock::now();
+
+thread_local ThreadBuffer *LOCAL_BUFFER {nullptr};
+
+ThreadBuffer &LocalBuffer() {
+    if (LOCAL_BUFFER == nullptr) {
+        std::lock_guard lg{registry_mutex};
+        registry.push_back(std::make_unique<ThreadBuffer>(registry.size() + 1));
+        LOCAL_BUFFER = registry.back().get();
+    }
+    return *LOCAL_BUFFER;
+}
+
+uint64_t NowNs() {
+    auto elapsed = std::chrono::steady_clock::now() - trace_start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void WriteEvent(std::ostream &out, const Event &event, uint32_t tid) {
+    // Timestamps are in microseconds.
+    char ts[32];
+    std::snprintf(ts, sizeof(ts), "%llu.%03llu",
+                  static_cast<unsigned long long>(event.timestamp_ns / 1000),
+                  static_cast<unsigned long long>(event.timestamp_ns % 1000));
+
+    out << "{\"name\":\"" << event.name << "\",\"cat\":\"async\",\"ph\":\""
+        << static_cast<char>(event.phase) << "\",\"ts\":" << ts
+        << ",\"pid\":1,\"tid\":" << tid;
+    switch (event.phase) {
+        case Phase::INSTANT:
+            out << ",\"s\":\"t\"";
+            break;
+        case Phase::FLOW_START:
+            out << ",\"id\":" << event.flow_id;
+            break;
+        case Phase::FLOW_END:
+            // Bind to the enclosing slice started at the same timestamp.
+            out << ",\"id\":" << event.flow_id << ",\"bp\":\"e\"";
+            break;
+        default:
+            break;
+    }
+    out << '}';
+}
+
+}   // namespace
+
+void Enable() {
+    _detail::_enabled.store(true);
+}
+
+void Disable() {
+    _detail::_enabled.store(false);
+}
+
+uint64_t NextFlowId() {
+    return next_flow_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Record(const char *name, Phase phase, uint64_t flow_id) {
+    if (!IsEnabled()) {
+        return;
+    }
+    LocalBuffer().Push(Event{name, NowNs(), flow_id, phase});
+}
+
+void WriteChromeJson(std::ostream &out) {
+    std::lock_guard lg{registry_mutex};
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto &buffer : registry) {
+        buffer->ForEach([&](const Event &event) {
+            if (!first) {
+                out << ",\n";
+            }
+            first = false;
+            WriteEvent(out, event, buffer->Tid());
+        });
+    }
+    out << "],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void Clear() {
+    std::lock_guard lg{registry_mutex};
+    for (auto &buffer : registry) {
+        buffer->Clear();
+    }
+}
+
+}   // namespace trace
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Opt-in tracing of tasks and continuations, exported as Chrome trace-event JSON
+// (chrome://tracing, ui.perfetto.dev).
+//
+// Hooks in the library are compiled in only with ASYNC_TRACING defined and record
+// nothing until `trace::Enable()` is called.
+
+namespace trace {
+
+enum class Phase : char {
+    BEGIN = 'B',
+    END = 'E',
+    INSTANT = 'i',
+    FLOW_START = 's',
+    FLOW_END = 'f',
+};
+
+struct Event {
+    // Must point to a string with static storage duration.
+    const char *name {nullptr};
+    uint64_t timestamp_ns {0};
+    // Links FLOW_START to FLOW_END, 0 for other phases.
+    uint64_t flow_id {0};
+    Phase phase {Phase::INSTANT};
+};
+
+namespace _detail {
+
+extern std::atomic<bool> _enabled;
+
+}   // namespace _detail
+
+inline bool IsEnabled() {
+    return _detail::_enabled.load(std::memory_order_relaxed);
+}
+
+void Enable();
+void Disable();
+
+// Unique non-zero id for a pair of flow events.
+uint64_t NextFlowId();
+
+// Appends an event to the calling thread's ring buffer if tracing is enabled.
+// Oldest events are overwritten once the buffer is full.
+void Record(const char *name, Phase phase, uint64_t flow_id = 0);
+
+// Both must be called while traced threads are quiescent,
+// events being recorded concurrently may be missed.
+void WriteChromeJson(std::ostream &out);
+void Clear();
+
+// Slice covering the lifetime of the scope, optionally ending a flow.
+class Scope {
+public:
+    explicit Scope(const char *name, uint64_t flow_id = 0) : name_(name), enabled_(IsEnabled()) {
+        if (enabled_) {
+            Record(name_, Phase::BEGIN);
+            if (flow_id != 0) {
+                Record(name_, Phase::FLOW_END, flow_id);
+            }
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() {
+        if (enabled_) {
+            Record(name_, Phase::END);
+        }
+    }
+
+private:
+    const char *name_;
+    bool enabled_;
+};
+
+// Names of events recorded by the library hooks.
+inline constexpr const char *TASK = "task";
+inline constexpr const char *SUBMIT = "submit";
+inline constexpr const char *FULFIL = "fulfil";
+inline constexpr const char *CONTINUATION = "continuation";
+
+}   // namespace trace
@@ -0,0 +1,499 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <random>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "macro_inheritance.h"
+
+// Per-call latency of dynamic dispatch: macro vtables (CALL_METHOD, and
+// CALL_METHOD_BATCH over pointers or over a MacroPartitionedArray), native
+// `virtual`, `std::variant` + `std::visit` and function-pointer type erasure.
+//
+// Every strategy has 16 classes, each with a method reading a field of the
+// object. Class hierarchies are shallow (all classes derive from the first)
+// or deep (a chain). A call site sees objects of 1 class (mono) or of all
+// the first 2, 4 or 16 classes in random order (poly, mega). Mono sites
+// are also called statically: a non-virtual method (macro_static) and
+// the virtual one through pointers to the final class (macro_final).
+// Hot runs go over 1024 objects, cold runs over 1M objects in shuffled order;
+// variants are stored by value, so their cold runs have no pointer chasing.
+//
+// Prints CSV, or JSON with `--json`.
+
+namespace {
+
+constexpr std::size_t MAX_CLASSES = 16;
+constexpr std::size_t CLASSES[] = {2, 4, 16};
+constexpr std::size_t HOT_OBJECTS = 1024;
+constexpr std::size_t COLD_OBJECTS = 1 << 20;
+constexpr std::size_t CALLS = 1 << 23;
+constexpr int REPEATS = 3;
+
+#ifdef MACRO_INHERITANCE_INLINE_CACHE
+constexpr const char *MACRO_STRATEGY = "macro_inline_cache";
+#else
+constexpr const char *MACRO_STRATEGY = "macro";
+#endif
+
+std::uint64_t ACC = 0;
+
+// Objects of all strategies fit a slot, they are trivially destructible.
+class Arena {
+public:
+    explicit Arena(std::size_t objects) : slots_(objects) {}
+
+    template <typename T>
+    T *New() {
+        static_assert(sizeof(T) <= sizeof(Slot) && alignof(T) <= alignof(Slot));
+        return new (&slots_[used_++]) T();
+    }
+
+private:
+    struct alignas(16) Slot {
+        std::byte bytes[32];
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t used_ {0};
+};
+
+}   // namespace
+
+// Macro hierarchies.
+BASE_CLASS_START(Shallow0, step)
+    int value;
+};
+
+BASE_CLASS_START(Deep0, step)
+    int value;
+};
+
+METHOD_START(Shallow0, step_static)
+    ACC += self->value;
+METHOD_END(Shallow0, step_static)
+
+VIRTUAL_METHOD_START(Shallow0, step)
+    ACC += self->value;
+VIRTUAL_METHOD_END(Shallow0, step)
+
+VIRTUAL_METHOD_START(Deep0, step)
+    ACC += self->value;
+VIRTUAL_METHOD_END(Deep0, step)
+
+CLASS_VTABLE(Shallow0)
+CLASS_VTABLE(Deep0)
+
+#define SHALLOW_CLASS(K)                                            \
+    FINAL_DERIVED_CLASS_START(Shallow##K, Shallow0)                 \
+    };                                                              \
+    VIRTUAL_METHOD_START(Shallow##K, step)                          \
+        ACC += DYNAMIC_CAST(self, Shallow0)->value + K;             \
+    VIRTUAL_METHOD_END(Shallow##K, step)                            \
+    CLASS_VTABLE(Shallow##K)
+
+#define DEEP_CLASS(K, BASE_K)                                       \
+    DERIVED_CLASS_START(Deep##K, Deep##BASE_K)                      \
+    };                                                              \
+    VIRTUAL_METHOD_START(Deep##K, step)                             \
+        ACC += DYNAMIC_CAST(self, Deep0)->value + K;                \
+    VIRTUAL_METHOD_END(Deep##K, step)                               \
+    CLASS_VTABLE(Deep##K)
+
+SHALLOW_CLASS(1)
+SHALLOW_CLASS(2)
+SHALLOW_CLASS(3)
+SHALLOW_CLASS(4)
+SHALLOW_CLASS(5)
+SHALLOW_CLASS(6)
+SHALLOW_CLASS(7)
+SHALLOW_CLASS(8)
+SHALLOW_CLASS(9)
+SHALLOW_CLASS(10)
+SHALLOW_CLASS(11)
+SHALLOW_CLASS(12)
+SHALLOW_CLASS(13)
+SHALLOW_CLASS(14)
+SHALLOW_CLASS(15)
+
+DEEP_CLASS(1, 0)
+DEEP_CLASS(2, 1)
+DEEP_CLASS(3, 2)
+DEEP_CLASS(4, 3)
+DEEP_CLASS(5, 4)
+DEEP_CLASS(6, 5)
+DEEP_CLASS(7, 6)
+DEEP_CLASS(8, 7)
+DEEP_CLASS(9, 8)
+DEEP_CLASS(10, 9)
+DEEP_CLASS(11, 10)
+DEEP_CLASS(12, 11)
+DEEP_CLASS(13, 12)
+DEEP_CLASS(14, 13)
+DEEP_CLASS(15, 14)
+
+namespace {
+
+// DYNAMIC_CAST evaluates its argument more than once.
+#define NEW_MACRO_OBJECT(ROOT, CLASS_NAME)              \
+    [](Arena &arena) {                                  \
+        CLASS_NAME *object = arena.New<CLASS_NAME>();   \
+        return DYNAMIC_CAST(object, ROOT);              \
+    }
+
+using NewShallow = Shallow0 *(*)(Arena &);
+using NewDeep = Deep0 *(*)(Arena &);
+
+const NewShallow NEW_SHALLOW[MAX_CLASSES] = {
+    NEW_MACRO_OBJECT(Shallow0, Shallow0), NEW_MACRO_OBJECT(Shallow0, Shallow1),
+    NEW_MACRO_OBJECT(Shallow0, Shallow2), NEW_MACRO_OBJECT(Shallow0, Shallow3),
+    NEW_MACRO_OBJECT(Shallow0, Shallow4), NEW_MACRO_OBJECT(Shallow0, Shallow5),
+    NEW_MACRO_OBJECT(Shallow0, Shallow6), NEW_MACRO_OBJECT(Shallow0, Shallow7),
+    NEW_MACRO_OBJECT(Shallow0, Shallow8), NEW_MACRO_OBJECT(Shallow0, Shallow9),
+    NEW_MACRO_OBJECT(Shallow0, Shallow10), NEW_MACRO_OBJECT(Shallow0, Shallow11),
+    NEW_MACRO_OBJECT(Shallow0, Shallow12), NEW_MACRO_OBJECT(Shallow0, Shallow13),
+    NEW_MACRO_OBJECT(Shallow0, Shallow14), NEW_MACRO_OBJECT(Shallow0, Shallow15),
+};
+
+const NewDeep NEW_DEEP[MAX_CLASSES] = {
+    NEW_MACRO_OBJECT(Deep0, Deep0), NEW_MACRO_OBJECT(Deep0, Deep1),
+    NEW_MACRO_OBJECT(Deep0, Deep2), NEW_MACRO_OBJECT(Deep0, Deep3),
+    NEW_MACRO_OBJECT(Deep0, Deep4), NEW_MACRO_OBJECT(Deep0, Deep5),
+    NEW_MACRO_OBJECT(Deep0, Deep6), NEW_MACRO_OBJECT(Deep0, Deep7),
+    NEW_MACRO_OBJECT(Deep0, Deep8), NEW_MACRO_OBJECT(Deep0, Deep9),
+    NEW_MACRO_OBJECT(Deep0, Deep10), NEW_MACRO_OBJECT(Deep0, Deep11),
+    NEW_MACRO_OBJECT(Deep0, Deep12), NEW_MACRO_OBJECT(Deep0, Deep13),
+    NEW_MACRO_OBJECT(Deep0, Deep14), NEW_MACRO_OBJECT(Deep0, Deep15),
+};
+
+#define NEW_PARTITIONED_OBJECT(CLASS_NAME) \
+    [](MacroPartitionedArray<Shallow0> &objects) { objects.emplace<CLASS_NAME>(); }
+
+using NewPartitioned = void (*)(MacroPartitionedArray<Shallow0> &);
+
+const NewPartitioned NEW_PARTITIONED[MAX_CLASSES] = {
+    NEW_PARTITIONED_OBJECT(Shallow0), NEW_PARTITIONED_OBJECT(Shallow1),
+    NEW_PARTITIONED_OBJECT(Shallow2), NEW_PARTITIONED_OBJECT(Shallow3),
+    NEW_PARTITIONED_OBJECT(Shallow4), NEW_PARTITIONED_OBJECT(Shallow5),
+    NEW_PARTITIONED_OBJECT(Shallow6), NEW_PARTITIONED_OBJECT(Shallow7),
+    NEW_PARTITIONED_OBJECT(Shallow8), NEW_PARTITIONED_OBJECT(Shallow9),
+    NEW_PARTITIONED_OBJECT(Shallow10), NEW_PARTITIONED_OBJECT(Shallow11),
+    NEW_PARTITIONED_OBJECT(Shallow12), NEW_PARTITIONED_OBJECT(Shallow13),
+    NEW_PARTITIONED_OBJECT(Shallow14), NEW_PARTITIONED_OBJECT(Shallow15),
+};
+
+// Native hierarchies.
+struct NativeRoot {
+    virtual void step() = 0;
+
+    int value {0};
+};
+
+template <std::size_t K>
+struct NativeShallow : NativeRoot {
+    void step() override {
+        ACC += value + K;
+    }
+};
+
+template <std::size_t K>
+struct NativeDeep : NativeDeep<K - 1> {
+    void step() override {
+        ACC += this->value + K;
+    }
+};
+
+template <>
+struct NativeDeep<0> : NativeRoot {
+    void step() override {
+        ACC += value;
+    }
+};
+
+// Closed set of types, for variants and type erasure.
+template <std::size_t K>
+struct Plain {
+    void step() {
+        ACC += value + K;
+    }
+
+    static void Step(void *object) {
+        static_cast<Plain *>(object)->step();
+    }
+
+    int value {0};
+};
+
+template <typename Seq>
+struct VariantOfImpl;
+
+template <std::size_t... K>
+struct VariantOfImpl<std::index_sequence<K...>> {
+    using type = std::variant<Plain<K>...>;
+};
+
+template <std::size_t N>
+using VariantOf = typename VariantOfImpl<std::make_index_sequence<N>>::type;
+
+struct Erased {
+    void (*step)(void *);
+    void *object;
+};
+
+template <std::size_t... K>
+NativeRoot *NewNativeShallow(Arena &arena, std::size_t k, std::index_sequence<K...>) {
+    NativeRoot *object = nullptr;
+    ((k == K ? (object = arena.New<NativeShallow<K>>()) : nullptr), ...);
+    return object;
+}
+
+template <std::size_t... K>
+NativeRoot *NewNativeDeep(Arena &arena, std::size_t k, std::index_sequence<K...>) {
+    NativeRoot *object = nullptr;
+    ((k == K ? (object = arena.New<NativeDeep<K>>()) : nullptr), ...);
+    return object;
+}
+
+template <std::size_t... K>
+Erased NewErased(Arena &arena, std::size_t k, std::index_sequence<K...>) {
+    Erased erased {};
+    ((k == K ? (erased = Erased{&Plain<K>::Step, arena.New<Plain<K>>()}, 0) : 0), ...);
+    return erased;
+}
+
+template <std::size_t N, std::size_t... K>
+VariantOf<N> NewVariant(std::size_t k, std::index_sequence<K...>) {
+    VariantOf<N> object;
+    ((k == K ? (object.template emplace<K>(), 0) : 0), ...);
+    return object;
+}
+
+// `pass()` makes `calls` calls.
+template <typename Pass>
+double NsPerCall(std::size_t calls, Pass &&pass) {
+    std::size_t passes = std::max<std::size_t>(1, CALLS / calls);
+    double best = 0;
+    for (int repeat = 0; repeat < REPEATS; ++repeat) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < passes; ++i) {
+            pass();
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        best = (repeat == 0) ? ns : std::min(best, ns);
+    }
+    return best / static_cast<double>(passes * calls);
+}
+
+template <typename Items, typename Call>
+double NsPerCall(Items &items, Call &&call) {
+    return NsPerCall(items.size(), [&items, &call]() {
+        for (auto &item : items) {
+            call(item);
+        }
+    });
+}
+
+struct Row {
+    const char *strategy;
+    const char *shape;
+    std::size_t classes;
+    const char *site;
+    std::size_t objects;
+    double ns_per_call;
+};
+
+struct Workload {
+    std::size_t classes;
+    bool mono;
+    std::size_t objects;
+    // Class of every object, in the order of calls.
+    std::vector<std::size_t> types;
+    // Objects are allocated in this order, which differs from the order
+    // of calls for cold runs.
+    std::vector<std::size_t> allocation_order;
+
+    const char *Site() const {
+        return mono ? "mono" : (classes == MAX_CLASSES ? "mega" : "poly");
+    }
+};
+
+Workload MakeWorkload(std::size_t classes, bool mono, std::size_t objects) {
+    std::mt19937 rng(static_cast<std::mt19937::result_type>(classes * 31 + objects));
+    Workload workload {classes, mono, objects, std::vector<std::size_t>(objects), std::vector<std::size_t>(objects)};
+    for (std::size_t i = 0; i < objects; ++i) {
+        workload.types[i] = mono ? classes - 1 : rng() % classes;
+        workload.allocation_order[i] = i;
+    }
+    if (objects > HOT_OBJECTS) {
+        std::shuffle(workload.allocation_order.begin(), workload.allocation_order.end(), rng);
+    }
+    return workload;
+}
+
+// Pointers to objects of `types`, allocated in `allocation_order`.
+template <typename Pointer, typename New>
+std::vector<Pointer> Allocate(const Workload &workload, Arena &arena, New &&make) {
+    std::vector<Pointer> pointers(workload.objects);
+    for (std::size_t i : workload.allocation_order) {
+        pointers[i] = make(arena, workload.types[i]);
+    }
+    return pointers;
+}
+
+// Calls through pointers to the final class of a mono site.
+template <typename C>
+double MeasureFinal(const std::vector<Shallow0 *> &objects) {
+    std::vector<C *> finals;
+    finals.reserve(objects.size());
+    for (Shallow0 *object : objects) {
+        finals.push_back(DYNAMIC_CAST(object, C));
+    }
+    return NsPerCall(finals, [](C *object) { CALL_METHOD(object, step); });
+}
+
+double MeasureFinal(const Workload &workload, const std::vector<Shallow0 *> &objects) {
+    switch (workload.classes) {
+        case 2:
+            return MeasureFinal<Shallow1>(objects);
+        case 4:
+            return MeasureFinal<Shallow3>(objects);
+        default:
+            return MeasureFinal<Shallow15>(objects);
+    }
+}
+
+template <std::size_t N>
+double MeasureVariant(const Workload &workload) {
+    std::vector<VariantOf<N>> objects;
+    objects.reserve(workload.objects);
+    for (std::size_t type : workload.types) {
+        objects.push_back(NewVariant<N>(type, std::make_index_sequence<N>()));
+    }
+    return NsPerCall(objects, [](VariantOf<N> &object) {
+        std::visit([](auto &alternative) { alternative.step(); }, object);
+    });
+}
+
+void Measure(const Workload &workload, std::vector<Row> &rows) {
+    auto add = [&](const char *strategy, const char *shape, double ns) {
+        rows.push_back(Row{strategy, shape, workload.classes, workload.Site(), workload.objects, ns});
+    };
+    constexpr auto ALL = std::make_index_sequence<MAX_CLASSES>();
+
+    {
+        Arena arena(workload.objects);
+        auto objects = Allocate<Shallow0 *>(workload, arena, [](Arena &a, std::size_t k) {
+            return NEW_SHALLOW[k](a);
+        });
+        add(MACRO_STRATEGY, "shallow", NsPerCall(objects, [](Shallow0 *object) { CALL_METHOD(object, step); }));
+        add("macro_batch", "shallow", NsPerCall(objects.size(), [&objects]() {
+            CALL_METHOD_BATCH(objects, step);
+        }));
+        if (workload.mono) {
+            add("macro_static", "shallow", NsPerCall(objects, [](Shallow0 *object) {
+                CALL_METHOD(object, step_static);
+            }));
+            add("macro_final", "shallow", MeasureFinal(workload, objects));
+        }
+    }
+    {
+        MacroPartitionedArray<Shallow0> objects;
+        for (std::size_t type : workload.types) {
+            NEW_PARTITIONED[type](objects);
+        }
+        add("macro_partitioned", "shallow", NsPerCall(objects.size(), [&objects]() {
+            CALL_METHOD_BATCH(objects, step);
+        }));
+    }
+    {
+        Arena arena(workload.objects);
+        auto objects = Allocate<Deep0 *>(workload, arena, [](Arena &a, std::size_t k) {
+            return NEW_DEEP[k](a);
+        });
+        add(MACRO_STRATEGY, "deep", NsPerCall(objects, [](Deep0 *object) { CALL_METHOD(object, step); }));
+    }
+    {
+        Arena arena(workload.objects);
+        auto objects = Allocate<NativeRoot *>(workload, arena, [ALL](Arena &a, std::size_t k) {
+            return NewNativeShallow(a, k, ALL);
+        });
+        add("native", "shallow", NsPerCall(objects, [](NativeRoot *object) { object->step(); }));
+    }
+    {
+        Arena arena(workload.objects);
+        auto objects = Allocate<NativeRoot *>(workload, arena, [ALL](Arena &a, std::size_t k) {
+            return NewNativeDeep(a, k, ALL);
+        });
+        add("native", "deep", NsPerCall(objects, [](NativeRoot *object) { object->step(); }));
+    }
+    {
+        Arena arena(workload.objects);
+        auto objects = Allocate<Erased>(workload, arena, [ALL](Arena &a, std::size_t k) {
+            return NewErased(a, k, ALL);
+        });
+        add("type_erasure", "flat", NsPerCall(objects, [](Erased &object) { object.step(object.object); }));
+    }
+
+    double variant_ns = 0;
+    switch (workload.classes) {
+        case 2:
+            variant_ns = MeasureVariant<2>(workload);
+            break;
+        case 4:
+            variant_ns = MeasureVariant<4>(workload);
+            break;
+        default:
+            variant_ns = MeasureVariant<MAX_CLASSES>(workload);
+            break;
+    }
+    add("variant", "flat", variant_ns);
+}
+
+void PrintCsv(const std::vector<Row> &rows) {
+    std::printf("strategy,shape,classes,site,objects,ns_per_call\n");
+    for (const auto &row : rows) {
+        std::printf("%s,%s,%zu,%s,%zu,%.3f\n", row.strategy, row.shape, row.classes, row.site,
+                    row.objects, row.ns_per_call);
+    }
+}
+
+void PrintJson(const std::vector<Row> &rows) {
+    std::printf("[\n");
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const auto &row = rows[i];
+        std::printf("  {\"strategy\": \"%s\", \"shape\": \"%s\", \"classes\": %zu, \"site\": \"%s\", "
+                    "\"objects\": %zu, \"ns_per_call\": %.3f}%s\n",
+                    row.strategy, row.shape, row.classes, row.site, row.objects, row.ns_per_call,
+                    (i + 1 == rows.size()) ? "" : ",");
+    }
+    std::printf("]\n");
+}
+
+}   // namespace
+
+int main(int argc, char **argv) {
+    bool json = argc > 1 && std::strcmp(argv[1], "--json") == 0;
+
+    std::vector<Row> rows;
+    for (std::size_t objects : {HOT_OBJECTS, COLD_OBJECTS}) {
+        for (std::size_t classes : CLASSES) {
+            for (bool mono : {true, false}) {
+                Measure(MakeWorkload(classes, mono, objects), rows);
+            }
+        }
+    }
+
+    if (json) {
+        PrintJson(rows);
+    } else {
+        PrintCsv(rows);
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "macro_inheritance.h"
+#include "macro_multimethods.h"
+
+// Per-call latency of double dispatch over 4 classes (a root and 3 derived
+// classes, pairs of objects in random order): MULTIMETHOD, CALL_METHOD on
+// the first object testing the class of the second one before DYNAMIC_CAST,
+// and the native visitor pattern (two `virtual` calls).
+
+namespace {
+
+constexpr std::size_t PAIRS = 1024;
+constexpr std::size_t CALLS = 1 << 23;
+constexpr int REPEATS = 3;
+
+std::uint64_t ACC = 0;
+
+}   // namespace
+
+BASE_CLASS_START(Shape, collide)
+    int size;
+};
+
+DERIVED_CLASS_START(Circle, Shape)
+};
+
+DERIVED_CLASS_START(Square, Shape)
+};
+
+DERIVED_CLASS_START(Triangle, Shape)
+};
+
+__attribute__((noinline)) int collide_shapes(Shape *a, Shape *b) {
+    return a->size + b->size;
+}
+
+__attribute__((noinline)) int collide_circles(Circle *a, Circle *b) {
+    return DYNAMIC_CAST(a, Shape)->size * DYNAMIC_CAST(b, Shape)->size;
+}
+
+__attribute__((noinline)) int collide_circle_square(Circle *a, Square *b) {
+    return DYNAMIC_CAST(a, Shape)->size - DYNAMIC_CAST(b, Shape)->size;
+}
+
+__attribute__((noinline)) int collide_square_circle(Square *a, Circle *b) {
+    return DYNAMIC_CAST(b, Shape)->size - DYNAMIC_CAST(a, Shape)->size;
+}
+
+__attribute__((noinline)) int collide_squares(Square *a, Square *b) {
+    return DYNAMIC_CAST(a, Shape)->size ^ DYNAMIC_CAST(b, Shape)->size;
+}
+
+MULTIMETHOD(collide, collide_shapes, collide_circles, collide_circle_square, collide_square_circle, collide_squares);
+
+VIRTUAL_METHOD_START(Shape, collide, int, (Shape *other))
+    return collide_shapes(self, other);
+VIRTUAL_METHOD_END(Shape, collide)
+
+VIRTUAL_METHOD_START(Circle, collide, int, (Shape *other))
+    if (other->_VTABLE_PTR == Circle::_CLASS_VTABLE()) {
+        return collide_circles(self, DYNAMIC_CAST(other, Circle));
+    }
+    if (other->_VTABLE_PTR == Square::_CLASS_VTABLE()) {
+        return collide_circle_square(self, DYNAMIC_CAST(other, Square));
+    }
+    return collide_shapes(DYNAMIC_CAST(self, Shape), other);
+VIRTUAL_METHOD_END(Circle, collide)
+
+VIRTUAL_METHOD_START(Square, collide, int, (Shape *other))
+    if (other->_VTABLE_PTR == Circle::_CLASS_VTABLE()) {
+        return collide_square_circle(self, DYNAMIC_CAST(other, Circle));
+    }
+    if (other->_VTABLE_PTR == Square::_CLASS_VTABLE()) {
+        return collide_squares(self, DYNAMIC_CAST(other, Square));
+    }
+    return collide_shapes(DYNAMIC_CAST(self, Shape), other);
+VIRTUAL_METHOD_END(Square, collide)
+
+CLASS_VTABLE(Shape)
+CLASS_VTABLE(Circle)
+CLASS_VTABLE(Square)
+CLASS_VTABLE(Triangle)
+
+namespace {
+
+namespace native {
+
+struct Circle;
+struct Square;
+
+struct Shape {
+    explicit Shape(int s) : size(s) {}
+    virtual ~Shape() = default;
+
+    virtual int collide(Shape &other) = 0;
+    virtual int collide_with(Shape &other) {
+        return other.size + size;
+    }
+    virtual int collide_with(Circle &other);
+    virtual int collide_with(Square &other);
+
+    int size;
+};
+
+struct Circle : Shape {
+    using Shape::Shape;
+    int collide(Shape &other) override {
+        return other.collide_with(*this);
+    }
+    int collide_with(Circle &other) override {
+        return other.size * size;
+    }
+    int collide_with(Square &other) override;
+};
+
+struct Square : Shape {
+    using Shape::Shape;
+    int collide(Shape &other) override {
+        return other.collide_with(*this);
+    }
+    int collide_with(Circle &other) override {
+        return other.size - size;
+    }
+    int collide_with(Square &other) override {
+        return other.size ^ size;
+    }
+};
+
+struct Triangle : Shape {
+    using Shape::Shape;
+    int collide(Shape &other) override {
+        return other.Shape::collide_with(*this);
+    }
+};
+
+// Dispatched on the second object, then on the first one.
+int Shape::collide_with(Circle &other) {
+    return other.size + size;
+}
+
+int Shape::collide_with(Square &other) {
+    return other.size + size;
+}
+
+int Circle::collide_with(Square &other) {
+    return size - other.size;
+}
+
+}   // namespace native
+
+template <typename T>
+using Pairs = std::vector<std::pair<T *, T *>>;
+
+template <typename T, typename F>
+double MeasureNsPerCall(const Pairs<T> &pairs, F &&collide) {
+    double best = 0;
+    for (int repeat = 0; repeat != REPEATS; ++repeat) {
+        std::uint64_t acc = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i != CALLS; ++i) {
+            const auto &pair = pairs[i % PAIRS];
+            acc += static_cast<std::uint64_t>(collide(pair.first, pair.second));
+        }
+        auto end = std::chrono::steady_clock::now();
+        ACC += acc;
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / CALLS;
+        best = repeat == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+}   // namespace
+
+int main() {
+    std::mt19937 random(42);
+    std::vector<int> kinds(2 * PAIRS);
+    for (int &kind : kinds) {
+        kind = static_cast<int>(random() % 4);
+    }
+
+    std::vector<Shape> shapes(PAIRS);
+    std::vector<Circle> circles(PAIRS);
+    std::vector<Square> squares(PAIRS);
+    std::vector<Triangle> triangles(PAIRS);
+    std::vector<std::unique_ptr<native::Shape>> native_objects;
+    std::vector<Shape *> objects;
+    // Native roots are abstract, triangles stand for them.
+    for (std::size_t i = 0; i != kinds.size(); ++i) {
+        int size = static_cast<int>(i % 7) + 1;
+        std::size_t slot = i / 2;
+        switch (kinds[i]) {
+        case 0:
+            objects.push_back(&shapes[slot]);
+            native_objects.push_back(std::make_unique<native::Triangle>(size));
+            break;
+        case 1:
+            objects.push_back(DYNAMIC_CAST(&circles[slot], Shape));
+            native_objects.push_back(std::make_unique<native::Circle>(size));
+            break;
+        case 2:
+            objects.push_back(DYNAMIC_CAST(&squares[slot], Shape));
+            native_objects.push_back(std::make_unique<native::Square>(size));
+            break;
+        default:
+            objects.push_back(DYNAMIC_CAST(&triangles[slot], Shape));
+            native_objects.push_back(std::make_unique<native::Triangle>(size));
+            break;
+        }
+        objects.back()->size = size;
+    }
+
+    Pairs<Shape> macro_pairs;
+    Pairs<native::Shape> native_pairs;
+    for (std::size_t i = 0; i != PAIRS; ++i) {
+        macro_pairs.emplace_back(objects[2 * i], objects[2 * i + 1]);
+        native_pairs.emplace_back(native_objects[2 * i].get(), native_objects[2 * i + 1].get());
+    }
+
+    std::printf("%20s %12s\n", "strategy", "ns_per_call");
+    std::printf("%20s %12.2f\n", "multimethod", MeasureNsPerCall(macro_pairs, [](Shape *a, Shape *b) {
+        return CALL_MULTIMETHOD(collide, a, b);
+    }));
+    std::printf("%20s %12.2f\n", "method_type_tests", MeasureNsPerCall(macro_pairs, [](Shape *a, Shape *b) {
+        return CALL_METHOD(a, collide, b);
+    }));
+    std::printf("%20s %12.2f\n", "native_visitor", MeasureNsPerCall(native_pairs, [](native::Shape *a, native::Shape *b) {
+        return a->collide(*b);
+    }));
+    return ACC != 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,186 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+
+#include "macro_inheritance.h"
+
+// Startup cost of 1000 classes with 2 virtual methods each: time spent in
+// the static initializers of this file and heap allocations they make.
+// Built twice: with the constant vtables of CLASS_VTABLE, and with
+// STARTUP_BENCH_LEGACY, the previous scheme where every vtable was a global
+// owning a `std::unordered_map` of methods filled by one static initializer
+// per method.
+
+namespace {
+
+std::size_t allocations = 0;
+
+// Dynamically initialized, before any other global of this file.
+const auto INIT_START = std::chrono::steady_clock::now();
+
+volatile int sink = 0;
+
+}   // namespace
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    if (void *ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// Inlined into the legacy scheme, GCC pairs them with the replaced `operator new`.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+#pragma GCC diagnostic pop
+
+#ifdef STARTUP_BENCH_LEGACY
+
+// Previous registration scheme, kept here for comparison.
+namespace legacy {
+
+using MethodType = void (*)(void *);
+
+struct VTable {
+    explicit VTable(std::size_t id, VTable *base)
+            : most_derived_vtable_ptr(base == nullptr ? this : base->most_derived_vtable_ptr),
+              base_vtable_ptr(base), type_id(id) {}
+
+    VTable *most_derived_vtable_ptr;
+    VTable *base_vtable_ptr;
+    std::size_t type_id;
+    std::unordered_map<const char *, MethodType> methods;
+};
+
+struct MethodVTableEmplacer {
+    explicit MethodVTableEmplacer(VTable &vtable, const char *name, MethodType method) {
+        vtable.methods.emplace(name, method);
+    }
+};
+
+void call(VTable *vtable, const char *name, void *object) {
+    for (; vtable != nullptr; vtable = vtable->base_vtable_ptr) {
+        auto iter = vtable->methods.find(name);
+        if (iter != vtable->methods.end()) {
+            iter->second(object);
+            return;
+        }
+    }
+}
+
+}   // namespace legacy
+
+#define LEGACY_METHOD(CLASS_NAME, METHOD_NAME, VALUE)                                   \
+    void CLASS_NAME ## _ ## METHOD_NAME(void *) {                                       \
+        sink = sink + (VALUE);                                                          \
+    }                                                                                   \
+    volatile legacy::MethodVTableEmplacer CLASS_NAME ## _ ## METHOD_NAME ## _EMPLACER(  \
+        CLASS_NAME ## _VTABLE, #METHOD_NAME, CLASS_NAME ## _ ## METHOD_NAME);
+
+legacy::VTable Root_VTABLE(__COUNTER__, nullptr);
+LEGACY_METHOD(Root, first, 1)
+LEGACY_METHOD(Root, second, 2)
+
+#define STARTUP_CLASS(CLASS_NAME)                                           \
+    legacy::VTable CLASS_NAME ## _VTABLE(__COUNTER__, &Root_VTABLE);        \
+    LEGACY_METHOD(CLASS_NAME, first, 3)                                     \
+    LEGACY_METHOD(CLASS_NAME, second, 4)
+
+constexpr const char *SCHEME = "legacy";
+
+#else
+
+BASE_CLASS_START(Root, first, second)
+    int value;
+};
+
+VIRTUAL_METHOD_START(Root, first)
+    sink = sink + 1;
+VIRTUAL_METHOD_END(Root, first)
+
+VIRTUAL_METHOD_START(Root, second)
+    sink = sink + 2;
+VIRTUAL_METHOD_END(Root, second)
+
+CLASS_VTABLE(Root)
+
+#define STARTUP_CLASS(CLASS_NAME)                   \
+    DERIVED_CLASS_START(CLASS_NAME, Root)           \
+    };                                              \
+    VIRTUAL_METHOD_START(CLASS_NAME, first)         \
+        sink = sink + 3;                            \
+    VIRTUAL_METHOD_END(CLASS_NAME, first)           \
+    VIRTUAL_METHOD_START(CLASS_NAME, second)        \
+        sink = sink + 4;                            \
+    VIRTUAL_METHOD_END(CLASS_NAME, second)          \
+    CLASS_VTABLE(CLASS_NAME)
+
+constexpr const char *SCHEME = "constant";
+
+#endif
+
+// Class names C000 to C999.
+#define STARTUP_CLASSES_10(PREFIX)                                          \
+    STARTUP_CLASS(PREFIX ## 0) STARTUP_CLASS(PREFIX ## 1)                   \
+    STARTUP_CLASS(PREFIX ## 2) STARTUP_CLASS(PREFIX ## 3)                   \
+    STARTUP_CLASS(PREFIX ## 4) STARTUP_CLASS(PREFIX ## 5)                   \
+    STARTUP_CLASS(PREFIX ## 6) STARTUP_CLASS(PREFIX ## 7)                   \
+    STARTUP_CLASS(PREFIX ## 8) STARTUP_CLASS(PREFIX ## 9)
+
+#define STARTUP_CLASSES_100(PREFIX)                                         \
+    STARTUP_CLASSES_10(PREFIX ## 0) STARTUP_CLASSES_10(PREFIX ## 1)         \
+    STARTUP_CLASSES_10(PREFIX ## 2) STARTUP_CLASSES_10(PREFIX ## 3)         \
+    STARTUP_CLASSES_10(PREFIX ## 4) STARTUP_CLASSES_10(PREFIX ## 5)         \
+    STARTUP_CLASSES_10(PREFIX ## 6) STARTUP_CLASSES_10(PREFIX ## 7)         \
+    STARTUP_CLASSES_10(PREFIX ## 8) STARTUP_CLASSES_10(PREFIX ## 9)
+
+STARTUP_CLASSES_100(C0)
+STARTUP_CLASSES_100(C1)
+STARTUP_CLASSES_100(C2)
+STARTUP_CLASSES_100(C3)
+STARTUP_CLASSES_100(C4)
+STARTUP_CLASSES_100(C5)
+STARTUP_CLASSES_100(C6)
+STARTUP_CLASSES_100(C7)
+STARTUP_CLASSES_100(C8)
+STARTUP_CLASSES_100(C9)
+
+namespace {
+
+constexpr int CLASSES = 1000;
+constexpr int METHODS_PER_CLASS = 2;
+
+// After all the globals of the scheme.
+const std::size_t INIT_ALLOCATIONS = allocations;
+const auto INIT_END = std::chrono::steady_clock::now();
+
+}   // namespace
+
+int main() {
+    // One call, so that the registrations are used.
+#ifdef STARTUP_BENCH_LEGACY
+    legacy::call(&C999_VTABLE, "second", nullptr);
+#else
+    C999 object;
+    CALL_METHOD(DYNAMIC_CAST(&object, Root), second);
+#endif
+
+    double init_us = std::chrono::duration<double, std::micro>(INIT_END - INIT_START).count();
+    std::printf("%10s %8s %8s %16s %12s\n", "scheme", "classes", "methods", "static_init_us", "allocations");
+    std::printf("%10s %8d %8d %16.1f %12zu\n", SCHEME, CLASSES, CLASSES * METHODS_PER_CLASS, init_us,
+                INIT_ALLOCATIONS);
+    return sink == 4 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,8 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
 #include <type_traits>
-#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// MACRO_INHERITANCE_INLINE_CACHE: every CALL_METHOD site of a virtual method
+// caches the methods it resolved for the last few vtables it has seen.
+// MACRO_INHERITANCE_CACHE_STATS: count hits and misses of these caches.
 
 namespace macro_detail {
 
@@ -23,31 +35,195 @@ struct FixedString {
 
 template<unsigned N> FixedString(const char (&)[N]) -> FixedString<N - 1>;
 
-using MethodType = void (*)(void *);
+// Erased method pointer, the size and alignment of every vtable entry.
+using MethodType = void (*)();
+
+// Mutable state of a class, next to its constant vtable. `number` is its
+// class index plus one, 0 until given.
+struct MacroClassNumber {
+    std::atomic<std::uint32_t> number {0};
+    std::atomic<std::uint32_t> classes_count {0};
+};
 
+// Virtual methods have dense slots per hierarchy: a class lists the virtual
+// methods it introduces, they get the slots following those of its base.
+// Every vtable is a flat array of all slots of its class, inherited entries
+// included, so a virtual call is one indexed load and an indirect call.
+//
+// Vtables are constants built at compile time by CLASS_VTABLE, they have no
+// dynamic initialization and live in read-only data.
 struct MacroBasedVTable {
-    MacroBasedVTable() = delete;
-    explicit MacroBasedVTable(std::size_t id, MacroBasedVTable *most_derived, MacroBasedVTable *base)
-            : base_vtable_ptr(base), type_id(id) {
-        most_derived_vtable_ptr = (most_derived == nullptr) ? this : most_derived;
+    // Entries follow the header, see MacroVTableStorage. Calls read an entry
+    // with the signature of its slot, which is the one of the method in it.
+    template <typename Method>
+    Method method(std::size_t slot) const {
+        auto entries = reinterpret_cast<const char *>(this + 1);
+        return *reinterpret_cast<const Method *>(entries + slot * sizeof(MethodType));
+    }
+
+    // Dense numbering of the classes of a hierarchy, from 0 to the count
+    // kept by its base class. Given on first use: numbers are runtime state.
+    std::uint32_t class_index() const {
+        std::uint32_t number = class_number_ptr->number.load(std::memory_order_relaxed);
+        return number != 0 ? number - 1 : assign_class_index();
+    }
+
+    std::uint32_t classes_count() const {
+        return most_derived_vtable_ptr->class_number_ptr->classes_count.load(std::memory_order_relaxed);
+    }
+
+    const MacroBasedVTable *most_derived_vtable_ptr;
+    const MacroBasedVTable *base_vtable_ptr;
+    std::size_t type_id;
+    std::size_t class_body_size;
+    std::size_t slots_count;
+    MacroClassNumber *class_number_ptr;
+
+private:
+    std::uint32_t assign_class_index() const {
+        std::uint32_t number = most_derived_vtable_ptr->class_number_ptr->classes_count.fetch_add(1) + 1;
+        std::uint32_t assigned = 0;
+        // Another thread may number the class first, this number is then unused.
+        if (!class_number_ptr->number.compare_exchange_strong(assigned, number)) {
+            return assigned - 1;
+        }
+        return number - 1;
+    }
+};
+
+// Entries of a vtable, laid out as an array of function pointers.
+// Each one keeps the type of its method: function pointers cannot be cast
+// in constant expressions. Slots with no method hold a null MethodType.
+template <typename... Methods>
+struct MethodTable {};
+
+template <typename Method, typename... Rest>
+struct MethodTable<Method, Rest...> {
+    static_assert(sizeof(Method) == sizeof(MethodType) && alignof(Method) == alignof(MethodType));
+
+    constexpr explicit MethodTable(Method method, Rest... rest) : first(method), rest(rest...) {}
+
+    Method first;
+    MethodTable<Rest...> rest;
+};
+
+template <std::size_t SLOT, typename Method, typename... Rest>
+constexpr auto table_entry(const MethodTable<Method, Rest...> &table) {
+    if constexpr (SLOT == 0) {
+        return table.first;
+    } else {
+        return table_entry<SLOT - 1>(table.rest);
     }
+}
 
-    MacroBasedVTable *most_derived_vtable_ptr {nullptr};
-    MacroBasedVTable *base_vtable_ptr {nullptr};
-    std::size_t type_id {0};
-    std::size_t class_body_size {0};
-    std::unordered_map<const char *, MethodType> methods;
+template <typename Table>
+struct MacroVTableStorage {
+    MacroBasedVTable header;
+    Table methods;
 };
 
-struct MethodVTableEmplacer {
-    explicit MethodVTableEmplacer(MacroBasedVTable &vtable, const char *name, MethodType method) {
-        auto inserted = vtable.methods.emplace(name, method);
-        assert(inserted.second);
+using TwoMethodsTable = MethodTable<MethodType, MethodType>;
+static_assert(offsetof(MacroVTableStorage<TwoMethodsTable>, methods) == sizeof(MacroBasedVTable));
+static_assert(offsetof(TwoMethodsTable, rest) == sizeof(MethodType));
+
+// Every VIRTUAL_METHOD_END declares `macro_method_impl(MethodKey<Class, slot>)`,
+// returning its method, and CLASS_VTABLE declares `macro_vtable_defined`
+// for all keys of its class. Both are found by ADL.
+template <typename C, long Slot>
+struct MethodKey {};
+
+template <typename C, long Slot>
+constexpr bool is_vtable_defined() {
+    return requires { macro_vtable_defined(MethodKey<C, Slot>{}); };
+}
+
+// The method of the class, else the entry of the base class for inherited
+// slots, else none.
+template <typename C, long Slot>
+constexpr auto class_slot_entry() {
+    if constexpr (requires { macro_method_impl(MethodKey<C, Slot>{}); }) {
+        return macro_method_impl(MethodKey<C, Slot>{});
+    } else if constexpr (Slot <= C::_SLOTS::_SLOTS_BEGIN) {
+        return table_entry<Slot>(C::_BASE::_CLASS_VTABLE_STORAGE().methods);
+    } else {
+        return MethodType{nullptr};
     }
+}
+
+template <typename C, std::size_t... Slots>
+constexpr auto make_method_table(std::index_sequence<Slots...>) {
+    return MethodTable<decltype(class_slot_entry<C, Slots>())...>(class_slot_entry<C, Slots>()...);
+}
+
+template <typename C>
+using MacroVTableOf = MacroVTableStorage<
+    decltype(make_method_table<C>(std::make_index_sequence<C::_SLOTS::_SLOTS_END>{}))>;
+
+// `self` is the vtable being built, the root of its hierarchy if the class
+// has no base.
+template <typename C>
+constexpr MacroVTableOf<C> make_vtable(const MacroVTableOf<C> &self, MacroClassNumber *class_number) {
+    const MacroBasedVTable *most_derived = &self.header;
+    const MacroBasedVTable *base = nullptr;
+    if constexpr (requires { typename C::_BASE; }) {
+        base = C::_BASE::_CLASS_VTABLE();
+        most_derived = base->most_derived_vtable_ptr;
+    }
+    return MacroVTableOf<C>{
+        MacroBasedVTable{most_derived, base, C::_CLASS_TAG, sizeof(C), C::_SLOTS::_SLOTS_END, class_number},
+        make_method_table<C>(std::make_index_sequence<C::_SLOTS::_SLOTS_END>{})};
+}
+
+struct InlineCacheStats {
+    std::uint64_t hits;
+    std::uint64_t misses;
 };
 
+// Over all call sites and threads.
+inline std::atomic<std::uint64_t> INLINE_CACHE_HITS {0};
+inline std::atomic<std::uint64_t> INLINE_CACHE_MISSES {0};
+
+inline InlineCacheStats get_inline_cache_stats() {
+    return InlineCacheStats{INLINE_CACHE_HITS.load(std::memory_order_relaxed),
+                            INLINE_CACHE_MISSES.load(std::memory_order_relaxed)};
+}
+
+// Signatures of virtual methods: every VIRTUAL_METHOD_END declares
+// `macro_slot_signature(SlotKey<Slots, slot>)`, returning a pointer to its
+// method, for the slots of the class which introduced the method.
+// Declarations with another return type for the same key do not compile,
+// so overrides have the signature of the method they override.
+template <typename Slots, long Slot>
+struct SlotKey {};
+
+// Slots introduced by a class are numbered after `_SLOTS_BEGIN`.
+template <typename Slots, long Slot>
+auto introducing_slots() {
+    if constexpr (Slot > Slots::_SLOTS_BEGIN) {
+        return std::type_identity<Slots>{};
+    } else {
+        return introducing_slots<typename Slots::_BASE_SLOTS, Slot>();
+    }
+}
+
+template <typename Slots, long Slot>
+using SlotKeyOf = SlotKey<typename decltype(introducing_slots<Slots, Slot>())::type, Slot>;
+
+// Found by ADL among the declarations preceding the call site.
+template <typename Slots, long Slot>
+using SlotMethod = decltype(macro_slot_signature(SlotKeyOf<Slots, Slot>{}));
+
+template <typename Key, typename Method>
+constexpr bool matches_slot_signature() {
+    if constexpr (requires { macro_slot_signature(Key{}); }) {
+        return std::is_same_v<decltype(macro_slot_signature(Key{})), Method>;
+    } else {
+        return true;
+    }
+}
+
 template <typename T, typename V>
-T *macro_dynamic_cast(V *object, MacroBasedVTable *from_object, MacroBasedVTable *from_target_class) {
+T *macro_dynamic_cast(V *object, const MacroBasedVTable *from_object, const MacroBasedVTable *from_target_class) {
     assert(object != nullptr);
     assert(from_object != nullptr);
     assert(from_target_class != nullptr);
@@ -57,93 +233,366 @@ T *macro_dynamic_cast(V *object, MacroBasedVTable *from_object, MacroBasedVTable
     }
 
     // Only downcasts are possible.
-    bool can_cast = from_object->most_derived_vtable_ptr == from_target_class->most_derived_vtable_ptr &&
+    [[maybe_unused]] bool can_cast = from_object->most_derived_vtable_ptr == from_target_class->most_derived_vtable_ptr &&
         from_object->type_id >= from_target_class->type_id;
     assert(can_cast);
     // Valid due to padding.
     return reinterpret_cast<T *>(object);
 }
 
+// Per call site and per thread, so it needs no synchronization.
+// Entries are taken round-robin, the first one is the only one used by
+// monomorphic sites.
+template <typename Method, std::size_t WAYS>
+class InlineCache {
+public:
+    Method lookup(const MacroBasedVTable *vtable, std::size_t slot) {
+        for (std::size_t way = 0; way != WAYS; ++way) {
+            if (vtables_[way] == vtable) {
+                count_inline_cache(true);
+                return methods_[way];
+            }
+        }
+        count_inline_cache(false);
+
+        Method method = vtable->method<Method>(slot);
+        vtables_[next_] = vtable;
+        methods_[next_] = method;
+        next_ = (next_ + 1) % WAYS;
+        return method;
+    }
+
+private:
+    static void count_inline_cache([[maybe_unused]] bool hit) {
+#ifdef MACRO_INHERITANCE_CACHE_STATS
+        (hit ? INLINE_CACHE_HITS : INLINE_CACHE_MISSES).fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+private:
+    const MacroBasedVTable *vtables_[WAYS] {};
+    Method methods_[WAYS] {};
+    std::size_t next_ {0};
+};
+
+constexpr std::size_t INLINE_CACHE_WAYS = 4;
+
+// `slot_of(Slots *)` returns the slot of the method in the `Slots` enumeration.
+// Calls on objects of a known class, `EXACT_TYPE` or final, are bound at
+// compile time once the vtable of the class is defined.
+template <bool EXACT_TYPE = false, typename T, typename SlotOf, typename... Args>
+decltype(auto) call_virtual(T *object, SlotOf, Args &&...args) {
+    constexpr std::size_t slot = SlotOf{}(static_cast<typename T::_SLOTS *>(nullptr));
+    using Method = SlotMethod<typename T::_SLOTS, slot>;
+    if constexpr ((EXACT_TYPE || T::_FINAL) && requires { macro_vtable_defined(MethodKey<T, slot>{}); }) {
+        constexpr auto method = table_entry<slot>(T::_CLASS_VTABLE_STORAGE().methods);
+        static_assert(std::is_same_v<decltype(method), const Method>, "virtual method not defined");
+        return method(object, std::forward<Args>(args)...);
+    } else {
+#ifdef MACRO_INHERITANCE_INLINE_CACHE
+        // One instance per call site: each site passes a lambda of its own type.
+        static thread_local InlineCache<Method, INLINE_CACHE_WAYS> cache;
+        Method method = cache.lookup(object->_VTABLE_PTR, slot);
+#else
+        Method method = object->_VTABLE_PTR->template method<Method>(slot);
+#endif
+        assert(method != nullptr && "virtual method not defined");
+        return method(object, std::forward<Args>(args)...);
+    }
+}
+
 template <typename Base, typename Derived>
 concept StaticMethodCallable = Base::_HIERARCHY_TAG == Derived::_HIERARCHY_TAG &&
     Base::_CLASS_TAG <= Derived::_CLASS_TAG;
 
 }   // namespace macro_detail
 
-template <typename T, macro_detail::FixedString MethodName>
-struct MacroMethodCaller {
-    static auto macro_call_method(T &object, const char *name) {
-        for (auto *current_vtable = object._VTABLE_PTR;
-                current_vtable != nullptr;
-                current_vtable = current_vtable->base_vtable_ptr) {
-            auto iter = current_vtable->methods.find(name);
-            if (iter != current_vtable->methods.end()) {
-                if constexpr (std::is_same_v<std::invoke_result_t<decltype(iter->second), void *>, void>) {
-                    iter->second(&object);
-                    return;
-                } else {
-                    return iter->second(&object);
+// Objects of a hierarchy stored by value, one contiguous array per class,
+// so that CALL_METHOD_BATCH runs one loop per class with no sorting.
+// Arrays grow by chunks: objects never move.
+template <typename Root>
+class MacroPartitionedArray {
+public:
+    MacroPartitionedArray() = default;
+
+    // Non-copyable
+    MacroPartitionedArray(const MacroPartitionedArray &) = delete;
+    MacroPartitionedArray &operator=(const MacroPartitionedArray &) = delete;
+
+    // Movable
+    MacroPartitionedArray(MacroPartitionedArray &&) = default;
+    MacroPartitionedArray &operator=(MacroPartitionedArray &&) = default;
+
+    ~MacroPartitionedArray() {
+        for (auto &partition : partitions_) {
+            partition.for_each([&partition](void *object) { partition.destroy(object); });
+        }
+    }
+
+    template <typename C, typename... Args>
+    requires macro_detail::StaticMethodCallable<Root, C>
+    C &emplace(Args &&...args) {
+        static_assert(alignof(C) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        const macro_detail::MacroBasedVTable *vtable = C::_CLASS_VTABLE();
+        std::size_t class_index = vtable->class_index();
+        if (partitions_.size() <= class_index) {
+            partitions_.resize(class_index + 1);
+        }
+
+        Partition &partition = partitions_[class_index];
+        if (partition.vtable == nullptr) {
+            partition.vtable = vtable;
+            partition.stride = sizeof(C);
+            partition.chunk_size = std::max<std::size_t>(1, CHUNK_BYTES / sizeof(C));
+            partition.destroy = [](void *object) { static_cast<C *>(object)->~C(); };
+        }
+        if (partition.size % partition.chunk_size == 0) {
+            partition.chunks.push_back(std::make_unique<std::byte[]>(partition.chunk_size * partition.stride));
+        }
+
+        void *place = partition.chunks.back().get() + (partition.size % partition.chunk_size) * partition.stride;
+        C *object = new (place) C(std::forward<Args>(args)...);
+        ++partition.size;
+        ++size_;
+        return *object;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    // `f(vtable, partition)` for every class with objects,
+    // `partition.for_each(g)` calls `g(object)` for each of them.
+    template <typename F>
+    void for_each_partition(F &&f) {
+        for (auto &partition : partitions_) {
+            if (partition.size != 0) {
+                f(*partition.vtable, partition);
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t CHUNK_BYTES = 16 * 1024;
+
+    struct Partition {
+        template <typename F>
+        void for_each(F &&f) {
+            std::size_t left = size;
+            for (auto &chunk : chunks) {
+                std::byte *object = chunk.get();
+                for (std::size_t i = std::min(left, chunk_size); i != 0; --i, object += stride) {
+                    f(object);
                 }
+                left -= std::min(left, chunk_size);
             }
         }
-        assert(false);
+
+        const macro_detail::MacroBasedVTable *vtable {nullptr};
+        std::size_t stride {0};
+        std::size_t chunk_size {0};
+        std::size_t size {0};
+        void (*destroy)(void *) {nullptr};
+        std::vector<std::unique_ptr<std::byte[]>> chunks;
+    };
+
+private:
+    std::vector<Partition> partitions_;
+    std::size_t size_ {0};
+};
+
+namespace macro_detail {
+
+// Smaller batches are dispatched one by one.
+constexpr std::size_t BATCH_SORT_THRESHOLD = 32;
+
+struct BatchScratch {
+    std::vector<std::uint32_t> classes;
+    std::vector<std::size_t> starts;
+    std::vector<std::size_t> positions;
+    std::vector<void *> sorted;
+};
+
+// Taken by a batch for its duration, a method running a batch itself
+// finds it empty.
+inline thread_local BatchScratch BATCH_SCRATCH;
+
+// Counting sort of the objects by class, then one loop per class with
+// the method resolved once.
+template <typename T, typename SlotOf, typename... Args>
+void call_virtual_batch(std::span<T *const> objects, SlotOf slot_of, const Args &...args) {
+    constexpr std::size_t slot = SlotOf{}(static_cast<typename T::_SLOTS *>(nullptr));
+    using Method = SlotMethod<typename T::_SLOTS, slot>;
+    if (objects.size() < BATCH_SORT_THRESHOLD) {
+        for (T *object : objects) {
+            call_virtual(object, slot_of, args...);
+        }
+        return;
+    }
+
+    BatchScratch scratch = std::exchange(BATCH_SCRATCH, {});
+
+    // Objects are read once, their classes are kept for the second pass.
+    // Classes are numbered before they are counted, numbers are given
+    // on first use.
+    scratch.classes.resize(objects.size());
+    for (std::size_t i = 0; i != objects.size(); ++i) {
+        scratch.classes[i] = objects[i]->_VTABLE_PTR->class_index();
+    }
+    std::size_t classes = objects.front()->_VTABLE_PTR->classes_count();
+    scratch.starts.assign(classes + 1, 0);
+    for (std::uint32_t c : scratch.classes) {
+        ++scratch.starts[c + 1];
+    }
+    for (std::size_t c = 0; c != classes; ++c) {
+        scratch.starts[c + 1] += scratch.starts[c];
+    }
+    scratch.positions.assign(scratch.starts.begin(), scratch.starts.end() - 1);
+    scratch.sorted.resize(objects.size());
+    for (std::size_t i = 0; i != objects.size(); ++i) {
+        scratch.sorted[scratch.positions[scratch.classes[i]]++] = objects[i];
+    }
+
+    for (std::size_t c = 0; c != classes; ++c) {
+        std::size_t begin = scratch.starts[c];
+        std::size_t end = scratch.starts[c + 1];
+        if (begin == end) {
+            continue;
+        }
+        Method method = static_cast<T *>(scratch.sorted[begin])->_VTABLE_PTR->template method<Method>(slot);
+        assert(method != nullptr && "virtual method not defined");
+        for (std::size_t i = begin; i != end; ++i) {
+            method(scratch.sorted[i], args...);
+        }
+    }
+
+    BATCH_SCRATCH = std::move(scratch);
+}
+
+template <typename Root, typename SlotOf, typename... Args>
+void call_method_batch(MacroPartitionedArray<Root> &objects, SlotOf, const Args &...args) {
+    constexpr std::size_t slot = SlotOf{}(static_cast<typename Root::_SLOTS *>(nullptr));
+    using Method = SlotMethod<typename Root::_SLOTS, slot>;
+    objects.for_each_partition([&args...](const MacroBasedVTable &vtable, auto &partition) {
+        Method method = vtable.method<Method>(slot);
+        assert(method != nullptr && "virtual method not defined");
+        partition.for_each([method, &args...](void *object) { method(object, args...); });
+    });
+}
+
+// Any contiguous range of pointers.
+template <typename Range, typename SlotOf, typename... Args>
+void call_method_batch(Range &&objects, SlotOf slot_of, const Args &...args) {
+    std::span span(objects);
+    using T = std::remove_pointer_t<typename decltype(span)::value_type>;
+    call_virtual_batch(std::span<T *const>(span), slot_of, args...);
+}
+
+}   // namespace macro_detail
+
+// Objects by value have the class of their type, references may not.
+template <typename T, macro_detail::FixedString MethodName>
+struct MacroMethodCaller {
+    template <typename SlotOf, typename... Args>
+    static decltype(auto) macro_call_method(T &object, SlotOf slot_of, Args &&...args) {
+        return macro_detail::call_virtual<!std::is_reference_v<T>>(&object, slot_of, std::forward<Args>(args)...);
     }
 };
 
 template <typename T, macro_detail::FixedString MethodName>
 struct MacroMethodCaller<T *, MethodName> {
-    static auto macro_call_method(T *object, const char *name) {
-        for (auto *current_vtable = object->_VTABLE_PTR;
-                current_vtable != nullptr;
-                current_vtable = current_vtable->base_vtable_ptr) {
-            auto iter = current_vtable->methods.find(name);
-            if (iter != current_vtable->methods.end()) {
-                if constexpr (std::is_same_v<std::invoke_result_t<decltype(iter->second), void *>, void>) {
-                    iter->second(object);
-                    return;
-                } else {
-                    return iter->second(object);
-                }
-            }
-        }
-        assert(false && "method not found");
+    template <typename SlotOf, typename... Args>
+    static decltype(auto) macro_call_method(T *object, SlotOf slot_of, Args &&...args) {
+        return macro_detail::call_virtual(object, slot_of, std::forward<Args>(args)...);
     }
 };
 
 #define GLOBAL_VTABLE_NAME(CLASS_NAME)              CLASS_NAME ## _GLOBAL_MACRO_VTABLE
 #define STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME) CLASS_NAME ## _ ## METHOD_NAME ## _METHOD_IMPL
 
-#define BASE_CLASS_START(CLASS_NAME)                            \
-macro_detail::MacroBasedVTable GLOBAL_VTABLE_NAME(CLASS_NAME)(  \
-    __COUNTER__, nullptr, nullptr);                             \
-struct CLASS_NAME {                                             \
-    static constexpr long _HIERARCHY_TAG = __COUNTER__;         \
-    static constexpr long _CLASS_TAG = __COUNTER__;             \
-    macro_detail::MacroBasedVTable *_VTABLE_PTR                 \
-        = &GLOBAL_VTABLE_NAME(CLASS_NAME);
-
-#define DERIVED_CLASS_START(CLASS_NAME, BASE_CLASS_NAME)                        \
-macro_detail::MacroBasedVTable GLOBAL_VTABLE_NAME(CLASS_NAME)(                  \
-    __COUNTER__,                                                                \
-    (GLOBAL_VTABLE_NAME(BASE_CLASS_NAME).most_derived_vtable_ptr == nullptr)    \
-        ? &GLOBAL_VTABLE_NAME(BASE_CLASS_NAME)                                  \
-        : GLOBAL_VTABLE_NAME(BASE_CLASS_NAME).most_derived_vtable_ptr,          \
-    &GLOBAL_VTABLE_NAME(BASE_CLASS_NAME));                                      \
-struct CLASS_NAME {                                                             \
-    static constexpr long _HIERARCHY_TAG = BASE_CLASS_NAME::_HIERARCHY_TAG;     \
-    static constexpr long _CLASS_TAG = __COUNTER__;                             \
-    macro_detail::MacroBasedVTable *_VTABLE_PTR                                 \
-        = &GLOBAL_VTABLE_NAME(CLASS_NAME);                                      \
-    char _BASE_PADDING[sizeof(BASE_CLASS_NAME) -                                \
-                       sizeof(macro_detail::MacroBasedVTable *)] = {0};
+#define SLOTS_NAME(CLASS_NAME)                      CLASS_NAME ## _MACRO_SLOTS
+#define VIRTUAL_METHOD_NAME(CLASS_NAME, METHOD_NAME) CLASS_NAME ## _ ## METHOD_NAME ## _VIRTUAL_METHOD_IMPL
+
+// Signature arguments of METHOD_START and VIRTUAL_METHOD_START: none for
+// `void()`, else the return type and the parenthesized parameters,
+// e.g. `double, (double scale, int times)`.
+#define METHOD_RETURN_TYPE(...)                     METHOD_RETURN_TYPE_IMPL(__VA_ARGS__ __VA_OPT__(,) void, (), _)
+#define METHOD_RETURN_TYPE_IMPL(RETURN_TYPE, PARAMETERS, ...) RETURN_TYPE
+#define METHOD_PARAMETERS(...)                      METHOD_PARAMETERS_IMPL(__VA_ARGS__ __VA_OPT__(,) void, (), _)
+#define METHOD_PARAMETERS_IMPL(RETURN_TYPE, PARAMETERS, ...) METHOD_PARAMETERS_WITH_OBJECT PARAMETERS
+#define METHOD_PARAMETERS_WITH_OBJECT(...)          (void *object __VA_OPT__(,) __VA_ARGS__)
+
+// Optional arguments: virtual methods introduced by the class, overrides
+// of inherited ones are not listed.
+// The vtable of the class is defined by CLASS_VTABLE, after its virtual methods.
+#define BASE_CLASS_START(CLASS_NAME, ...) BASE_CLASS_START_IMPL(false, CLASS_NAME, __VA_ARGS__)
+#define DERIVED_CLASS_START(CLASS_NAME, BASE_CLASS_NAME, ...)                           \
+    DERIVED_CLASS_START_IMPL(false, CLASS_NAME, BASE_CLASS_NAME, __VA_ARGS__)
+
+// Final classes have no derived classes: calls through pointers to them
+// are bound at compile time, as calls on objects by value.
+#define FINAL_BASE_CLASS_START(CLASS_NAME, ...) BASE_CLASS_START_IMPL(true, CLASS_NAME, __VA_ARGS__)
+#define FINAL_DERIVED_CLASS_START(CLASS_NAME, BASE_CLASS_NAME, ...)                     \
+    DERIVED_CLASS_START_IMPL(true, CLASS_NAME, BASE_CLASS_NAME, __VA_ARGS__)
+
+#define BASE_CLASS_START_IMPL(FINAL, CLASS_NAME, ...)                   \
+struct SLOTS_NAME(CLASS_NAME) {                                         \
+    enum : long { _SLOTS_BEGIN = -1, __VA_ARGS__ __VA_OPT__(,) _SLOTS_END };\
+};                                                                      \
+struct CLASS_NAME {                                                     \
+    using _SLOTS = SLOTS_NAME(CLASS_NAME);                              \
+    static constexpr long _HIERARCHY_TAG = __COUNTER__;                 \
+    static constexpr long _CLASS_TAG = __COUNTER__;                     \
+    static constexpr bool _FINAL = FINAL;                               \
+    static constexpr const macro_detail::MacroBasedVTable *_CLASS_VTABLE(); \
+    static constexpr const auto &_CLASS_VTABLE_STORAGE();               \
+    const macro_detail::MacroBasedVTable *_VTABLE_PTR = _CLASS_VTABLE();
+
+#define DERIVED_CLASS_START_IMPL(FINAL, CLASS_NAME, BASE_CLASS_NAME, ...)               \
+static_assert(!BASE_CLASS_NAME::_FINAL, #CLASS_NAME " derives from final class " #BASE_CLASS_NAME); \
+struct SLOTS_NAME(CLASS_NAME) : SLOTS_NAME(BASE_CLASS_NAME) {                           \
+    using _BASE_SLOTS = SLOTS_NAME(BASE_CLASS_NAME);                                    \
+    enum : long {                                                                       \
+        _SLOTS_BEGIN = SLOTS_NAME(BASE_CLASS_NAME)::_SLOTS_END - 1,                     \
+        __VA_ARGS__ __VA_OPT__(,) _SLOTS_END                                            \
+    };                                                                                  \
+};                                                                                      \
+struct CLASS_NAME {                                                                     \
+    using _SLOTS = SLOTS_NAME(CLASS_NAME);                                              \
+    using _BASE = BASE_CLASS_NAME;                                                      \
+    static constexpr long _HIERARCHY_TAG = BASE_CLASS_NAME::_HIERARCHY_TAG;             \
+    static constexpr long _CLASS_TAG = __COUNTER__;                                     \
+    static constexpr bool _FINAL = FINAL;                                               \
+    static constexpr const macro_detail::MacroBasedVTable *_CLASS_VTABLE();             \
+    static constexpr const auto &_CLASS_VTABLE_STORAGE();                               \
+    const macro_detail::MacroBasedVTable *_VTABLE_PTR = _CLASS_VTABLE();                \
+    char _BASE_PADDING[sizeof(BASE_CLASS_NAME) -                                        \
+                       sizeof(const macro_detail::MacroBasedVTable *)] = {0};
+
+// After the virtual methods of the class and the CLASS_VTABLE of its base.
+// The vtable is a constant: nothing runs at startup.
+#define CLASS_VTABLE(CLASS_NAME)                                                        \
+template <long Slot>                                                                    \
+void macro_vtable_defined(macro_detail::MethodKey<CLASS_NAME, Slot>);                   \
+constinit macro_detail::MacroClassNumber CLASS_NAME ## _MACRO_CLASS_NUMBER;            \
+constexpr macro_detail::MacroVTableOf<CLASS_NAME> GLOBAL_VTABLE_NAME(CLASS_NAME) =      \
+    macro_detail::make_vtable<CLASS_NAME>(GLOBAL_VTABLE_NAME(CLASS_NAME),               \
+                                          &CLASS_NAME ## _MACRO_CLASS_NUMBER);          \
+constexpr const auto &CLASS_NAME::_CLASS_VTABLE_STORAGE() {                             \
+    return GLOBAL_VTABLE_NAME(CLASS_NAME);                                              \
+}                                                                                       \
+constexpr const macro_detail::MacroBasedVTable *CLASS_NAME::_CLASS_VTABLE() {           \
+    return &GLOBAL_VTABLE_NAME(CLASS_NAME).header;                                      \
+}
 
 #define DYNAMIC_CAST(OBJECT, CLASS_NAME)                                    \
     macro_detail::macro_dynamic_cast<CLASS_NAME>(                           \
-        (OBJECT), (OBJECT)->_VTABLE_PTR, &GLOBAL_VTABLE_NAME(CLASS_NAME))
+        (OBJECT), (OBJECT)->_VTABLE_PTR, CLASS_NAME::_CLASS_VTABLE())
 
 
-#define METHOD_START(CLASS_NAME, METHOD_NAME)                                   \
-void STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(void *object) {                \
+#define METHOD_START(CLASS_NAME, METHOD_NAME, ...)                                      \
+METHOD_RETURN_TYPE(__VA_ARGS__)                                                         \
+STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME) METHOD_PARAMETERS(__VA_ARGS__) {            \
     [[maybe_unused]] CLASS_NAME *self = reinterpret_cast<CLASS_NAME *>(object);
 
 #define METHOD_END(CLASS_NAME, METHOD_NAME)                                                     \
@@ -151,45 +600,50 @@ void STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(void *object) {
 template <typename T>                                                                           \
 requires macro_detail::StaticMethodCallable<CLASS_NAME, T>                                      \
 struct MacroMethodCaller<T *, #METHOD_NAME> {                                                   \
-    static auto macro_call_method(T *object, [[maybe_unused]] const char *name) {               \
-        if constexpr (std::is_same_v<std::invoke_result_t<                                      \
-                        decltype(STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)), void *>,         \
-                        void>) {                                                                \
-            STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(object);                                \
-            return;                                                                             \
-        } else {                                                                                \
-            return STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(object);                         \
-        }                                                                                       \
+    template <typename SlotOf, typename... Args>                                                \
+    static decltype(auto) macro_call_method(T *object, SlotOf, Args &&...args) {                \
+        return STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(object, std::forward<Args>(args)...); \
     }                                                                                           \
 };                                                                                              \
 template <typename T>                                                                           \
 requires macro_detail::StaticMethodCallable<CLASS_NAME, T>                                      \
 struct MacroMethodCaller<T, #METHOD_NAME> {                                                     \
-    static auto macro_call_method(T &object, [[maybe_unused]] const char *name) {               \
-        if constexpr (std::is_same_v<std::invoke_result_t<                                      \
-                        decltype(STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)), void *>,         \
-                        void>) {                                                                \
-            STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(&object);                               \
-            return;                                                                             \
-        } else {                                                                                \
-            return STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(&object);                        \
-        }                                                                                       \
+    template <typename SlotOf, typename... Args>                                                \
+    static decltype(auto) macro_call_method(T &object, SlotOf, Args &&...args) {                \
+        return STATIC_METHOD_NAME(CLASS_NAME, METHOD_NAME)(&object, std::forward<Args>(args)...); \
     }                                                                                           \
 };
 
-#define VIRTUAL_METHOD_START(CLASS_NAME, METHOD_NAME)                           \
-void CLASS_NAME ## _ ## METHOD_NAME ## _VIRTUAL_METHOD_IMPL(void *object) {     \
+#define VIRTUAL_METHOD_START(CLASS_NAME, METHOD_NAME, ...)                              \
+METHOD_RETURN_TYPE(__VA_ARGS__)                                                         \
+VIRTUAL_METHOD_NAME(CLASS_NAME, METHOD_NAME) METHOD_PARAMETERS(__VA_ARGS__) {           \
     [[maybe_unused]] CLASS_NAME *self = reinterpret_cast<CLASS_NAME *>(object);
 
-#define VIRTUAL_METHOD_END(CLASS_NAME, METHOD_NAME)                 \
-}                                                                   \
-volatile macro_detail::MethodVTableEmplacer                         \
-    CLASS_NAME ## _ ## METHOD_NAME ## _METHOD_VTABLE_EMPLACER(      \
-        GLOBAL_VTABLE_NAME(CLASS_NAME),                             \
-        #METHOD_NAME,                                               \
-        CLASS_NAME ## _ ## METHOD_NAME ## _VIRTUAL_METHOD_IMPL);
+#define VIRTUAL_METHOD_END(CLASS_NAME, METHOD_NAME)                                             \
+}                                                                                               \
+static_assert(macro_detail::matches_slot_signature<                                             \
+                  macro_detail::SlotKeyOf<SLOTS_NAME(CLASS_NAME), SLOTS_NAME(CLASS_NAME)::METHOD_NAME>, \
+                  decltype(&VIRTUAL_METHOD_NAME(CLASS_NAME, METHOD_NAME))>(),                   \
+              "signature of " #CLASS_NAME "::" #METHOD_NAME " differs from the overridden one"); \
+static_assert(!macro_detail::is_vtable_defined<CLASS_NAME, SLOTS_NAME(CLASS_NAME)::METHOD_NAME>(), \
+              "virtual method " #CLASS_NAME "::" #METHOD_NAME " follows CLASS_VTABLE(" #CLASS_NAME ")"); \
+decltype(&VIRTUAL_METHOD_NAME(CLASS_NAME, METHOD_NAME)) macro_slot_signature(                   \
+    macro_detail::SlotKeyOf<SLOTS_NAME(CLASS_NAME), SLOTS_NAME(CLASS_NAME)::METHOD_NAME>);      \
+constexpr auto macro_method_impl(                                                               \
+        macro_detail::MethodKey<CLASS_NAME, SLOTS_NAME(CLASS_NAME)::METHOD_NAME>) {             \
+    return &VIRTUAL_METHOD_NAME(CLASS_NAME, METHOD_NAME);                                       \
+}
+
 
+// Calls a virtual method on every object of a contiguous range of pointers,
+// or of a MacroPartitionedArray, with the same arguments. Objects are called
+// grouped by class, not in order. Results are discarded.
+#define CALL_METHOD_BATCH(OBJECTS, METHOD_NAME, ...)                        \
+    macro_detail::call_method_batch(                                        \
+        (OBJECTS), []<typename Slots>(Slots *) { return Slots::METHOD_NAME; } __VA_OPT__(,) __VA_ARGS__)
 
-#define CALL_METHOD(OBJECT, METHOD_NAME)                                    \
+// The slot is looked up only for virtual methods, statically bound ones
+// have no slot.
+#define CALL_METHOD(OBJECT, METHOD_NAME, ...)                               \
     MacroMethodCaller<decltype(OBJECT), #METHOD_NAME>::macro_call_method(   \
-        (OBJECT), #METHOD_NAME)
+        (OBJECT), []<typename Slots>(Slots *) { return Slots::METHOD_NAME; } __VA_OPT__(,) __VA_ARGS__)
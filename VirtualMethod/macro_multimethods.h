@@ -0,0 +1,433 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "macro_inheritance.h"
+
+// Multiple dispatch over classes of macro hierarchies.
+//
+// Implementations are functions taking pointers to objects of macro classes
+// first, the dispatched arguments, then other arguments, the same for all of
+// them. A call runs the implementation whose classes are, argument by
+// argument, the closest bases of the classes of the objects.
+//
+// The dispatch table is built on the first call, one dimension per
+// dispatched argument. Classes are merged when they select the same
+// implementations along a dimension, then identical rows and columns are
+// merged. A call costs one offset lookup per object, a load from the table
+// and an indirect call.
+
+namespace macro_detail {
+
+template <typename T>
+concept MacroClass = requires { T::_HIERARCHY_TAG; };
+
+template <typename Param>
+constexpr bool is_dispatched_param() {
+    if constexpr (std::is_pointer_v<Param>) {
+        return MacroClass<std::remove_pointer_t<Param>>;
+    } else {
+        return false;
+    }
+}
+
+// Number of leading pointers to macro classes.
+template <typename... Params>
+constexpr std::size_t dispatched_count() {
+    std::size_t count = 0;
+    bool leading = true;
+    ((leading = leading && is_dispatched_param<Params>(), count += leading ? 1 : 0), ...);
+    return count;
+}
+
+template <std::size_t>
+using ErasedObject = void *;
+
+template <auto IMPL>
+struct MultimethodImplTraits;
+
+template <typename R, typename... Params, R (*IMPL)(Params...)>
+struct MultimethodImplTraits<IMPL> {
+    using Return = R;
+    static constexpr std::size_t ARITY = dispatched_count<Params...>();
+    static_assert(ARITY > 0, "a multimethod implementation takes pointers to objects of macro classes first");
+
+    template <std::size_t I>
+    using Param = std::tuple_element_t<I, std::tuple<Params...>>;
+
+    template <std::size_t I>
+    using Class = std::remove_pointer_t<Param<I>>;
+
+    template <typename Seq>
+    struct ExtrasOf;
+
+    template <std::size_t... E>
+    struct ExtrasOf<std::index_sequence<E...>> {
+        using type = std::tuple<Param<ARITY + E>...>;
+    };
+
+    using Extras = typename ExtrasOf<std::make_index_sequence<sizeof...(Params) - ARITY>>::type;
+};
+
+// Implementations called with erased objects.
+template <auto IMPL, typename Traits, typename Seq, typename Extras>
+struct MultimethodThunk;
+
+template <auto IMPL, typename Traits, std::size_t... I, typename... Extras>
+struct MultimethodThunk<IMPL, Traits, std::index_sequence<I...>, std::tuple<Extras...>> {
+    static typename Traits::Return call(ErasedObject<I>... objects, Extras... extras) {
+        return IMPL(static_cast<typename Traits::template Param<I>>(objects)..., std::forward<Extras>(extras)...);
+    }
+
+    // When no implementation, or no single most specific one, takes the objects.
+    static typename Traits::Return missing(ErasedObject<I>..., Extras...) {
+        assert(false && "multimethod not defined for these classes");
+        std::abort();
+    }
+
+    static typename Traits::Return ambiguous(ErasedObject<I>..., Extras...) {
+        assert(false && "ambiguous multimethod call");
+        std::abort();
+    }
+};
+
+inline bool is_same_or_derived(const MacroBasedVTable *derived, const MacroBasedVTable *base) {
+    // Bases have smaller type ids.
+    for (; derived != nullptr && derived->type_id >= base->type_id; derived = derived->base_vtable_ptr) {
+        if (derived == base) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct MultimethodCandidate {
+    std::vector<const MacroBasedVTable *> classes;
+    MethodType method;
+};
+
+// Up to 64 implementations: the implementations taking a class along
+// a dimension are a mask.
+class MultimethodTable {
+public:
+    static constexpr std::size_t MAX_IMPLS = 64;
+
+    MultimethodTable(std::size_t arity, const std::vector<MultimethodCandidate> &impls,
+                     MethodType missing, MethodType ambiguous)
+            : dimensions_(arity) {
+        assert(impls.size() <= MAX_IMPLS);
+
+        // Classes named by implementations, merged by mask. Group 0 is
+        // for classes with none of them as base.
+        std::vector<std::vector<std::uint64_t>> group_masks(arity, std::vector<std::uint64_t>{0});
+        for (std::size_t d = 0; d != arity; ++d) {
+            for (const auto &impl : impls) {
+                const MacroBasedVTable *named = impl.classes[d];
+                std::uint64_t mask = 0;
+                for (std::size_t k = 0; k != impls.size(); ++k) {
+                    if (is_same_or_derived(named, impls[k].classes[d])) {
+                        mask |= std::uint64_t{1} << k;
+                    }
+                }
+                auto &masks = group_masks[d];
+                std::size_t group = 0;
+                while (group != masks.size() && masks[group] != mask) {
+                    ++group;
+                }
+                if (group == masks.size()) {
+                    masks.push_back(mask);
+                }
+                add_named_class(dimensions_[d], named, group);
+            }
+        }
+
+        // Full table over groups, the first dimension varying slowest.
+        std::vector<std::size_t> sizes(arity);
+        for (std::size_t d = 0; d != arity; ++d) {
+            sizes[d] = group_masks[d].size();
+        }
+        std::vector<MethodType> entries(cells(sizes));
+        std::vector<std::size_t> groups(arity, 0);
+        for (MethodType &entry : entries) {
+            std::uint64_t applicable = ~std::uint64_t{0};
+            for (std::size_t d = 0; d != arity; ++d) {
+                applicable &= group_masks[d][groups[d]];
+            }
+            entry = most_specific(impls, applicable, missing, ambiguous);
+            next_cell(groups, sizes);
+        }
+
+        for (std::size_t d = 0; d != arity; ++d) {
+            compress(entries, sizes, d);
+        }
+        entries_ = std::move(entries);
+
+        // Indices become offsets.
+        std::size_t stride = 1;
+        for (std::size_t d = arity; d-- != 0;) {
+            for (auto &named : dimensions_[d].named) {
+                named.offset *= stride;
+            }
+            dimensions_[d].others_offset *= stride;
+            stride *= sizes[d];
+        }
+    }
+
+    // Offset in the table of the class along dimension `d`, through its
+    // closest base named by an implementation.
+    std::size_t offset(std::size_t d, const MacroBasedVTable *vtable) const {
+        const Dimension &dimension = dimensions_[d];
+        for (; vtable != nullptr; vtable = vtable->base_vtable_ptr) {
+            for (const auto &named : dimension.named) {
+                if (named.vtable == vtable) {
+                    return named.offset;
+                }
+            }
+        }
+        return dimension.others_offset;
+    }
+
+    MethodType entry(std::size_t offset) const {
+        return entries_[offset];
+    }
+
+    std::size_t size() const {
+        return entries_.size();
+    }
+
+private:
+    struct NamedClass {
+        const MacroBasedVTable *vtable;
+        // Group, then index once compressed, then offset.
+        std::size_t offset;
+    };
+
+    struct Dimension {
+        std::vector<NamedClass> named;
+        std::size_t others_offset {0};
+    };
+
+    static void add_named_class(Dimension &dimension, const MacroBasedVTable *vtable, std::size_t group) {
+        for (const auto &named : dimension.named) {
+            if (named.vtable == vtable) {
+                return;
+            }
+        }
+        dimension.named.push_back(NamedClass{vtable, group});
+    }
+
+    static std::size_t cells(const std::vector<std::size_t> &sizes) {
+        std::size_t count = 1;
+        for (std::size_t size : sizes) {
+            count *= size;
+        }
+        return count;
+    }
+
+    static void next_cell(std::vector<std::size_t> &indices, const std::vector<std::size_t> &sizes) {
+        for (std::size_t d = indices.size(); d-- != 0;) {
+            if (++indices[d] != sizes[d]) {
+                return;
+            }
+            indices[d] = 0;
+        }
+    }
+
+    // The applicable implementation whose classes are all derived from
+    // (or the same as) those of every other applicable one.
+    static MethodType most_specific(const std::vector<MultimethodCandidate> &impls, std::uint64_t applicable,
+                                    MethodType missing, MethodType ambiguous) {
+        const MultimethodCandidate *best = nullptr;
+        for (std::size_t k = 0; k != impls.size(); ++k) {
+            if ((applicable >> k & 1) == 0) {
+                continue;
+            }
+            if (best == nullptr || more_specific(impls[k], *best)) {
+                best = &impls[k];
+            }
+        }
+        if (best == nullptr) {
+            return missing;
+        }
+        for (std::size_t k = 0; k != impls.size(); ++k) {
+            if ((applicable >> k & 1) != 0 && &impls[k] != best && !more_specific(*best, impls[k])) {
+                return ambiguous;
+            }
+        }
+        return best->method;
+    }
+
+    static bool more_specific(const MultimethodCandidate &a, const MultimethodCandidate &b) {
+        bool different = false;
+        for (std::size_t d = 0; d != a.classes.size(); ++d) {
+            if (!is_same_or_derived(a.classes[d], b.classes[d])) {
+                return false;
+            }
+            different = different || a.classes[d] != b.classes[d];
+        }
+        return different;
+    }
+
+    // Merges the indices of dimension `d` whose slices of the table are equal.
+    void compress(std::vector<MethodType> &entries, std::vector<std::size_t> &sizes, std::size_t d) {
+        std::size_t inner = 1;
+        for (std::size_t i = d + 1; i != sizes.size(); ++i) {
+            inner *= sizes[i];
+        }
+        std::size_t outer = entries.size() / (inner * sizes[d]);
+        auto same_slice = [&](std::size_t a, std::size_t b) {
+            for (std::size_t o = 0; o != outer; ++o) {
+                for (std::size_t i = 0; i != inner; ++i) {
+                    if (entries[(o * sizes[d] + a) * inner + i] != entries[(o * sizes[d] + b) * inner + i]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        std::vector<std::size_t> kept;
+        std::vector<std::size_t> merged_into(sizes[d]);
+        for (std::size_t index = 0; index != sizes[d]; ++index) {
+            std::size_t k = 0;
+            while (k != kept.size() && !same_slice(kept[k], index)) {
+                ++k;
+            }
+            if (k == kept.size()) {
+                kept.push_back(index);
+            }
+            merged_into[index] = k;
+        }
+
+        std::vector<MethodType> compressed(outer * kept.size() * inner);
+        for (std::size_t o = 0; o != outer; ++o) {
+            for (std::size_t k = 0; k != kept.size(); ++k) {
+                for (std::size_t i = 0; i != inner; ++i) {
+                    compressed[(o * kept.size() + k) * inner + i] = entries[(o * sizes[d] + kept[k]) * inner + i];
+                }
+            }
+        }
+        entries = std::move(compressed);
+        sizes[d] = kept.size();
+
+        for (auto &named : dimensions_[d].named) {
+            named.offset = merged_into[named.offset];
+        }
+        dimensions_[d].others_offset = merged_into[dimensions_[d].others_offset];
+    }
+
+private:
+    std::vector<Dimension> dimensions_;
+    std::vector<MethodType> entries_;
+};
+
+// Offsets by class index, per thread so that it needs no synchronization.
+// Stored plus one, 0 until looked up. Trivial, so that calls reach it
+// without the initialization check of `thread_local` objects.
+struct MultimethodOffsets {
+    std::uint32_t *data;
+    std::size_t size;
+};
+
+__attribute__((noinline)) inline std::size_t lookup_offset(const MultimethodTable &table, MultimethodOffsets &offsets,
+                                                         std::vector<std::uint32_t> &storage, std::size_t d,
+                                                         const MacroBasedVTable *vtable) {
+    std::uint32_t index = vtable->class_index();
+    if (storage.size() <= index) {
+        storage.resize(index + 1, 0);
+        offsets = MultimethodOffsets{storage.data(), storage.size()};
+    }
+    std::size_t offset = table.offset(d, vtable);
+    storage[index] = static_cast<std::uint32_t>(offset + 1);
+    return offset;
+}
+
+template <auto FIRST, auto... IMPLS>
+class Multimethod {
+    using Traits = MultimethodImplTraits<FIRST>;
+    using Return = typename Traits::Return;
+    using Extras = typename Traits::Extras;
+    static constexpr std::size_t ARITY = Traits::ARITY;
+    using Dispatched = std::make_index_sequence<ARITY>;
+    using Thunk = MultimethodThunk<FIRST, Traits, Dispatched, Extras>;
+
+    static_assert(sizeof...(IMPLS) + 1 <= MultimethodTable::MAX_IMPLS);
+
+    template <auto IMPL, std::size_t... I>
+    static constexpr bool same_signature(std::index_sequence<I...>) {
+        using Other = MultimethodImplTraits<IMPL>;
+        return Other::ARITY == ARITY && std::is_same_v<typename Other::Return, Return> &&
+            std::is_same_v<typename Other::Extras, Extras> &&
+            ((Other::template Class<I>::_HIERARCHY_TAG == Traits::template Class<I>::_HIERARCHY_TAG) && ...);
+    }
+
+    static_assert((same_signature<IMPLS>(Dispatched{}) && ...),
+                  "implementations of a multimethod take the same hierarchies and arguments, and return the same type");
+
+    template <auto IMPL, std::size_t... I>
+    static MultimethodCandidate candidate(std::index_sequence<I...>) {
+        using ImplTraits = MultimethodImplTraits<IMPL>;
+        auto method = &MultimethodThunk<IMPL, ImplTraits, Dispatched, Extras>::call;
+        return MultimethodCandidate{{ImplTraits::template Class<I>::_CLASS_VTABLE()...},
+                                    reinterpret_cast<MethodType>(method)};
+    }
+
+    __attribute__((noinline)) static MultimethodTable build() {
+        return MultimethodTable(
+            ARITY, {candidate<FIRST>(Dispatched{}), candidate<IMPLS>(Dispatched{})...},
+            reinterpret_cast<MethodType>(&Thunk::missing), reinterpret_cast<MethodType>(&Thunk::ambiguous));
+    }
+
+    static const MultimethodTable &table() {
+        // Built on the first call.
+        static const MultimethodTable TABLE = build();
+        return TABLE;
+    }
+
+    template <std::size_t D>
+    static std::size_t object_offset(const MultimethodTable &dispatch_table, const MacroBasedVTable *vtable) {
+        static thread_local MultimethodOffsets offsets;
+        std::uint32_t index = vtable->class_index();
+        if (index < offsets.size && offsets.data[index] != 0) [[likely]] {
+            return offsets.data[index] - 1;
+        }
+        static thread_local std::vector<std::uint32_t> storage;
+        return lookup_offset(dispatch_table, offsets, storage, D, vtable);
+    }
+
+    template <typename Arguments, std::size_t... I, std::size_t... E>
+    static Return dispatch(Arguments &&arguments, std::index_sequence<I...>, std::index_sequence<E...>) {
+        static_assert(((std::remove_pointer_t<std::decay_t<std::tuple_element_t<I, std::decay_t<Arguments>>>>
+                            ::_HIERARCHY_TAG == Traits::template Class<I>::_HIERARCHY_TAG) && ...),
+                      "objects of a multimethod call are from the hierarchies of its implementations");
+        const MultimethodTable &dispatch_table = table();
+        std::size_t offset = (object_offset<I>(dispatch_table, std::get<I>(arguments)->_VTABLE_PTR) + ...);
+        auto method = reinterpret_cast<decltype(&Thunk::call)>(dispatch_table.entry(offset));
+        return method(std::get<I>(arguments)..., std::get<ARITY + E>(std::move(arguments))...);
+    }
+
+public:
+    template <typename... Args>
+    static Return call(Args &&...args) {
+        constexpr std::size_t EXTRAS = std::tuple_size_v<Extras>;
+        static_assert(sizeof...(Args) == ARITY + EXTRAS, "wrong number of multimethod arguments");
+        return dispatch(std::forward_as_tuple(std::forward<Args>(args)...),
+                        Dispatched{}, std::make_index_sequence<EXTRAS>{});
+    }
+};
+
+}   // namespace macro_detail
+
+// After the declarations of the implementations, in any order.
+#define MULTIMETHOD(NAME, ...) using NAME ## _MULTIMETHOD = macro_detail::Multimethod<__VA_ARGS__>
+
+// Pointers to the dispatched objects first, then the other arguments.
+#define CALL_MULTIMETHOD(NAME, ...) NAME ## _MULTIMETHOD::call(__VA_ARGS__)
@@ -1,8 +1,10 @@
 #include <iostream>
+#include <vector>
 
 #include "macro_inheritance.h"
+#include "macro_multimethods.h"
 
-BASE_CLASS_START(Base)
+BASE_CLASS_START(Base, print, scaled)
     int a;
 };
 
@@ -15,7 +17,18 @@ VIRTUAL_METHOD_START(Base, print)
 VIRTUAL_METHOD_END(Base, print)
 
 
-DERIVED_CLASS_START(Derived, Base)
+VIRTUAL_METHOD_START(Base, scaled, double, (double factor))
+    return self->a * factor;
+VIRTUAL_METHOD_END(Base, scaled)
+
+METHOD_START(Base, add, int, (int x, int y))
+    return self->a + x + y;
+METHOD_END(Base, add)
+
+CLASS_VTABLE(Base)
+
+
+FINAL_DERIVED_CLASS_START(Derived, Base)
     double b;
     int c;
 };
@@ -24,16 +37,39 @@ VIRTUAL_METHOD_START(Derived, print)
     std::cout << "Derived::print: " << self->b << std::endl;
 VIRTUAL_METHOD_END(Derived, print)
 
+VIRTUAL_METHOD_START(Derived, scaled, double, (double factor))
+    return self->b * factor;
+VIRTUAL_METHOD_END(Derived, scaled)
+
 METHOD_START(Derived, only_derived)
     std::cout << "Derived::only_derived: " << self->c << std::endl;
 METHOD_END(Derived, only_derived)
 
+CLASS_VTABLE(Derived)
+
+double combine(Base *x, Base *y, double weight) {
+    return (x->a + y->a) * weight;
+}
+
+double combine(Derived *x, Base *y, double weight) {
+    return (x->b + y->a) * weight;
+}
+
+double combine(Derived *x, Derived *y, double weight) {
+    return (x->b + y->b) * weight;
+}
+
+MULTIMETHOD(combine,
+            static_cast<double (*)(Base *, Base *, double)>(combine),
+            static_cast<double (*)(Derived *, Base *, double)>(combine),
+            static_cast<double (*)(Derived *, Derived *, double)>(combine));
+
 int main() {
     Base base;
     base.a = 2;
     // Resolves statically.
     CALL_METHOD(base, simple);
-    // Resolves dynamically.
+    // Virtual, resolves statically: `base` is an object by value.
     CALL_METHOD(base, print);
     std::cout << "base.a = " << base.a << std::endl;
 
@@ -42,22 +78,49 @@ int main() {
     derived.c = 4;
     // Resolves statically.
     CALL_METHOD(derived, simple);
-    // Resolves dynamically.
-    CALL_METHOD(derived, print);
+    // Virtual, resolves statically: `Derived` is final.
+    CALL_METHOD(&derived, print);
     // Resolves statically.
     CALL_METHOD(derived, only_derived);
     std::cout << "derived.b = " << derived.b << std::endl;
     std::cout << "derived.c = " << derived.c << std::endl;
 
     Base *to_based = DYNAMIC_CAST(&derived, Base);
+    to_based->a = 1;
     // Resolves statically.
     CALL_METHOD(to_based, simple);
     // Resolves dynamically.
     CALL_METHOD(to_based, print);
     std::cout << "to_based->a = " << to_based->a << std::endl;
 
-    // Runtime error.
-    CALL_METHOD(to_based, only_derived);
+    // Arguments and results, resolves dynamically.
+    std::cout << "scaled: " << CALL_METHOD(&base, scaled, 10.0)
+              << ", " << CALL_METHOD(to_based, scaled, 10.0) << std::endl;
+    // Resolves statically.
+    std::cout << "add: " << CALL_METHOD(base, add, 3, 4) << std::endl;
+
+    std::vector<Base *> objects = {&base, to_based, &base};
+    // Resolves dynamically, once per class for large batches.
+    CALL_METHOD_BATCH(objects, print);
+
+    MacroPartitionedArray<Base> partitioned;
+    partitioned.emplace<Derived>().b = 1.5;
+    partitioned.emplace<Base>().a = 6;
+    // One loop per class.
+    CALL_METHOD_BATCH(partitioned, print);
+
+    // Resolves dynamically on the classes of both objects.
+    std::cout << "combine: " << CALL_MULTIMETHOD(combine, &base, to_based, 2.0)
+              << ", " << CALL_MULTIMETHOD(combine, to_based, &base, 2.0)
+              << ", " << CALL_MULTIMETHOD(combine, to_based, to_based, 2.0) << std::endl;
+
+    // Compile-time error: `only_derived` is not a method of `Base`.
+    // CALL_METHOD(to_based, only_derived);
+
+#ifdef MACRO_INHERITANCE_CACHE_STATS
+    auto stats = macro_detail::get_inline_cache_stats();
+    std::cout << "inline caches: " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+#endif
 
     return 0;
 }
@@ -0,0 +1,51 @@
+import os
+import subprocess
+import sys
+import time
+
+# Wall time of `fib.bin` under `runtime.py` and under the native engine
+# (the `vm` CMake target), interpreted and with the JIT, for the same n and
+# with the same output. The other sample programs are checked first.
+#
+# Usage: python3 bench/engine_bench.py PATH_TO_VM [N ...]
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PROGRAM = os.path.join(ROOT, "fib.bin")
+SAMPLES = ["hello_world_8.bin"]
+DEFAULT_NS = [10, 15, 20]
+
+
+def run(command: list[str], stdin: str) -> tuple[float, str]:
+    start = time.perf_counter()
+    result = subprocess.run(command, input=stdin, capture_output=True, text=True, check=True)
+    return time.perf_counter() - start, result.stdout
+
+
+def main():
+    if len(sys.argv) < 2:
+        raise RuntimeError("Specify the vm executable")
+
+    vm = sys.argv[1]
+    ns = [int(n) for n in sys.argv[2:]] or DEFAULT_NS
+
+    runtime = [sys.executable, os.path.join(ROOT, "runtime.py")]
+
+    for sample in SAMPLES:
+        path = os.path.join(ROOT, sample)
+        outputs = [run(command, "")[1] for command in (runtime + [path], [vm, path], [vm, path, "JIT"])]
+        if outputs.count(outputs[0]) != len(outputs):
+            raise RuntimeError(f"Different output for {sample}:\n" + "\n".join(outputs))
+
+    print(f"{'n':>4} {'runtime.py, s':>14} {'vm, s':>10} {'vm JIT, s':>10} {'speedup':>10} {'JIT speedup':>12}")
+    for n in ns:
+        python_time, python_output = run(runtime + [PROGRAM], f"{n}\n")
+        vm_time, vm_output = run([vm, PROGRAM], f"{n}\n")
+        jit_time, jit_output = run([vm, PROGRAM, "JIT"], f"{n}\n")
+        if not python_output == vm_output == jit_output:
+            raise RuntimeError(f"Different output for n={n}:\n{python_output}\n{vm_output}\n{jit_output}")
+        print(f"{n:>4} {python_time:>14.3f} {vm_time:>10.4f} {jit_time:>10.4f} "
+              f"{python_time / vm_time:>10.1f} {python_time / jit_time:>12.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstddef>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "vm/interpreter.h"
+#include "vm/machine.h"
+
+#ifdef VM_JIT
+#include "vm/jit.h"
+#endif
+
+// Instructions per second of the interpreter on the recursive `fib.bin`
+// for large n: one counting run for the number of instructions, then the
+// best of a few runs without counting. Program output is discarded. With
+// the JIT, the same runs with compiled blocks, which must leave the same
+// result in `rv`.
+//
+// Usage: interpreter_bench [N ...]
+
+namespace {
+
+constexpr int REPEATS = 3;
+constexpr int DEFAULT_NS[] = {20, 25, 30};
+
+template <typename F>
+double MeasureSeconds(F &&run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+struct Result {
+    double seconds;
+    vm::Word rv;
+};
+
+// Best of REPEATS runs of `run` on a fresh machine.
+template <typename F>
+Result Measure(const vm::Program &program, int n, std::FILE *sink, F &&run) {
+    Result best{0, 0};
+    for (int repeat = 0; repeat != REPEATS; ++repeat) {
+        std::istringstream input(std::to_string(n) + "\n");
+        vm::Machine machine(program, input, sink);
+        double seconds = MeasureSeconds([&] { run(machine); });
+        best.seconds = repeat == 0 ? seconds : std::min(best.seconds, seconds);
+        best.rv = machine.Registers()[vm::RV_INDEX];
+    }
+    return best;
+}
+
+}   // namespace
+
+int main(int argc, char **argv) {
+    std::vector<int> ns(static_cast<std::size_t>(argc - 1));
+    std::transform(argv + 1, argv + argc, ns.begin(), [](const char *n) { return std::atoi(n); });
+    if (ns.empty()) {
+        ns.assign(std::begin(DEFAULT_NS), std::end(DEFAULT_NS));
+    }
+
+    vm::Program program = vm::LoadProgram(VM_PROGRAMS_DIR "/fib.bin");
+    std::FILE *sink = std::fopen("/dev/null", "w");
+
+    std::printf("%4s %14s %10s %14s", "n", "instructions", "seconds", "minstr_per_s");
+#ifdef VM_JIT
+    std::printf(" %10s %14s %8s", "jit_s", "jit_minstr_s", "speedup");
+#endif
+    std::printf("\n");
+
+    for (int n : ns) {
+        std::istringstream input(std::to_string(n) + "\n");
+        vm::Machine counting(program, input, sink);
+        auto instructions = static_cast<double>(vm::InterpretCounting(counting));
+
+        Result interpreted = Measure(program, n, sink, [](vm::Machine &machine) { vm::Interpret(machine); });
+        std::printf("%4d %14.0f %10.4f %14.1f", n, instructions, interpreted.seconds,
+                    instructions / interpreted.seconds / 1e6);
+#ifdef VM_JIT
+        Result compiled = Measure(program, n, sink, [](vm::Machine &machine) {
+            vm::Jit jit(machine);
+            vm::InterpretCompiling(machine, jit);
+        });
+        if (compiled.rv != interpreted.rv) {
+            std::fprintf(stderr, "\nrv %d with the JIT, %d interpreted\n", compiled.rv, interpreted.rv);
+            return EXIT_FAILURE;
+        }
+        std::printf(" %10.4f %14.1f %8.2f", compiled.seconds, instructions / compiled.seconds / 1e6,
+                    interpreted.seconds / compiled.seconds);
+#endif
+        std::printf("\n");
+    }
+
+    std::fclose(sink);
+    return EXIT_SUCCESS;
+}
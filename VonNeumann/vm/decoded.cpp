@@ -0,0 +1,79 @@
+#include "vm/decoded.h"
+
+namespace vm {
+
+DecodedCode::DecodedCode(const Word *memory, Word begin, std::uint32_t size)
+        : begin_(begin), size_(size), code_(memory + begin),
+          opcode_(size + 1), access1_(size + 1), register1_(size + 1), access2_(size + 1),
+          register2_(size + 1), immediate_(size + 1), target_(size + 1, NO_TARGET) {
+    for (std::uint32_t i = 0; i != size_; ++i) {
+        Decode(i, WrapAdd(begin_, static_cast<Word>(i)), code_[i]);
+    }
+    Link();
+}
+
+void DecodedCode::Redecode(std::uint32_t index, Word word) {
+    ++generation_;
+    Decode(index, WrapAdd(begin_, static_cast<Word>(index)), word);
+    Link();
+}
+
+std::uint32_t DecodedCode::DecodeOutside(Word ip, Word word) {
+    Decode(size_, ip, word);
+    return size_;
+}
+
+void DecodedCode::Decode(std::uint32_t index, Word ip, Word word) {
+    auto instruction = static_cast<std::uint32_t>(word);
+    std::uint32_t opcode = DecodeOpcode(instruction);
+
+    opcode_[index] = static_cast<std::uint8_t>(opcode);
+    access1_[index] = static_cast<std::uint8_t>(DecodeAccess1(instruction));
+    register1_[index] = static_cast<std::uint8_t>(DecodeRegister1(instruction));
+    access2_[index] = static_cast<std::uint8_t>(DecodeAccess2(instruction));
+    register2_[index] = static_cast<std::uint8_t>(DecodeRegister2(instruction));
+    target_[index] = NO_TARGET;
+
+    switch (opcode) {
+    case CALL:
+    case FBEGIN:
+        immediate_[index] = Slot(DecodeImmediate(instruction));
+        break;
+    case PRINTSTR:
+        immediate_[index] = DecodeImmediate(instruction);
+        break;
+    case JUMP_IF_GZ:
+        immediate_[index] = DecodeRegisterImmediate(instruction);
+        target_[index] = WrapAdd(ip, immediate_[index]);
+        break;
+    default:
+        immediate_[index] = DecodeRegisterImmediate(instruction);
+        break;
+    }
+}
+
+Word DecodedCode::Slot(Word function_number) {
+    auto [iter, inserted] = function_slots_.emplace(function_number, static_cast<Word>(function_numbers_.size()));
+    if (inserted) {
+        function_numbers_.push_back(function_number);
+        function_starts_.push_back(UNDEFINED);
+    }
+    return iter->second;
+}
+
+// Instructions up to the next FEND are skipped one by one in `runtime.py`,
+// an unknown opcode among them still raises: such FBEGINs keep no target.
+void DecodedCode::Link() {
+    Word next_fend = NO_TARGET;
+    for (std::uint32_t i = size_; i-- != 0;) {
+        if (opcode_[i] == FEND) {
+            next_fend = WrapAdd(begin_, static_cast<Word>(i + 1));
+        } else if (opcode_[i] >= OPCODES_COUNT) {
+            next_fend = NO_TARGET;
+        } else if (opcode_[i] == FBEGIN) {
+            target_[i] = next_fend;
+        }
+    }
+}
+
+}   // namespace vm
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "vm/isa.h"
+
+namespace vm {
+
+// Instructions of the code region decoded once, at load, one array per
+// field. The entry past the code is for instructions run from elsewhere in
+// memory, decoded when they are reached.
+//
+// Link-time data is resolved by the same pass: CALL immediates become
+// slots of the function table, FBEGIN gets the address after its FEND and
+// JUMP_IF_GZ the address it jumps to.
+class DecodedCode {
+public:
+    static constexpr Word NO_TARGET = -1;
+    static constexpr std::int64_t UNDEFINED = -1;
+
+    // Code of `size` words at `begin` in `memory`.
+    DecodedCode(const Word *memory, Word begin, std::uint32_t size);
+
+    Word Begin() const {
+        return begin_;
+    }
+
+    std::uint32_t Size() const {
+        return size_;
+    }
+
+    // After a write into the code.
+    void Redecode(std::uint32_t index, Word word);
+
+    // Changes with every write into the code.
+    std::uint64_t Generation() const {
+        return generation_;
+    }
+
+    // Decodes the instruction at `ip` outside the code into the extra entry.
+    std::uint32_t DecodeOutside(Word ip, Word word);
+
+    const std::uint8_t *Opcodes() const {
+        return opcode_.data();
+    }
+
+    const std::uint8_t *Accesses1() const {
+        return access1_.data();
+    }
+
+    const std::uint8_t *Registers1() const {
+        return register1_.data();
+    }
+
+    const std::uint8_t *Accesses2() const {
+        return access2_.data();
+    }
+
+    const std::uint8_t *Registers2() const {
+        return register2_.data();
+    }
+
+    // Function slot for CALL and FBEGIN, the immediate for other instructions.
+    const Word *Immediates() const {
+        return immediate_.data();
+    }
+
+    const Word *Targets() const {
+        return target_.data();
+    }
+
+    // Functions are callable once their FBEGIN runs, as in `runtime.py`.
+    std::int64_t FunctionStart(Word slot) const {
+        return function_starts_[slot];
+    }
+
+    void DefineFunction(Word slot, Word start) {
+        function_starts_[slot] = start;
+    }
+
+    // Stays valid as slots are added.
+    const std::int64_t *FunctionStartAddress(Word slot) const {
+        return &function_starts_[slot];
+    }
+
+    Word FunctionNumber(Word slot) const {
+        return function_numbers_[slot];
+    }
+
+    // For INDIR_CALL, NO_TARGET for numbers without FBEGIN or CALL.
+    Word FunctionSlot(Word function_number) const {
+        auto iter = function_slots_.find(function_number);
+        return iter == function_slots_.end() ? NO_TARGET : iter->second;
+    }
+
+private:
+    void Decode(std::uint32_t index, Word ip, Word word);
+    Word Slot(Word function_number);
+    void Link();
+
+private:
+    Word begin_;
+    std::uint32_t size_;
+    const Word *code_;
+
+    std::vector<std::uint8_t> opcode_;
+    std::vector<std::uint8_t> access1_;
+    std::vector<std::uint8_t> register1_;
+    std::vector<std::uint8_t> access2_;
+    std::vector<std::uint8_t> register2_;
+    std::vector<Word> immediate_;
+    std::vector<Word> target_;
+    std::uint64_t generation_ {0};
+
+    std::deque<std::int64_t> function_starts_;
+    std::vector<Word> function_numbers_;
+    std::unordered_map<Word, Word> function_slots_;
+};
+
+}   // namespace vm
@@ -0,0 +1,274 @@
+#include "vm/interpreter.h"
+
+#include <string>
+
+#include "vm/jit.h"
+#include "vm/profiler.h"
+
+#if !defined(__GNUC__)
+#error "the interpreter dispatches with computed goto, a GCC and Clang extension"
+#endif
+
+namespace vm {
+
+namespace {
+
+std::string ToBinary(std::uint32_t instruction) {
+    std::string binary(32, '0');
+    for (int bit = 0; bit != 32; ++bit) {
+        if ((instruction >> (31 - bit) & 1) != 0) {
+            binary[bit] = '1';
+        }
+    }
+    return binary;
+}
+
+// Direct threading: every handler ends with its own fetch and indirect jump
+// to the next handler, instead of returning to a central loop.
+//
+// Handlers read the fields decoded at load and written again by stores
+// into the code. FBEGIN jumps past its FEND; when the target is unknown
+// the instructions up to FEND are skipped one by one through a second
+// table, where only FEND and unknown opcodes have handlers.
+//
+// The other modes count instructions, go through the compiled blocks
+// after jumps, or feed the profiler.
+enum class Mode { PLAIN, COUNTING, COMPILING, PROFILING };
+
+template <Mode MODE>
+std::uint64_t Run(Machine &machine, [[maybe_unused]] Jit *jit, [[maybe_unused]] Profiler *profiler) {
+    static const void *const EXECUTE[OPCODE_VALUES] = {
+        &&mov, &&add, &&sub, &&pop, &&push, &&call, &&fbegin, &&fend,
+        &&term, &&jump, &&jump_if_gz, &&print, &&read, &&printstr, &&loadl, &&loadh,
+        &&addi, &&subi, &&indir_call, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown,
+        &&unknown, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown,
+    };
+    static const void *const SKIP[OPCODE_VALUES] = {
+        &&skip, &&skip, &&skip, &&skip, &&skip, &&skip, &&skip, &&fend,
+        &&skip, &&skip, &&skip, &&skip, &&skip, &&skip, &&skip, &&skip,
+        &&skip, &&skip, &&skip, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown,
+        &&unknown, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown, &&unknown,
+    };
+
+    Word *registers = machine.Registers();
+    DecodedCode &code = machine.Code();
+    const std::uint8_t *opcodes = code.Opcodes();
+    const std::uint8_t *accesses1 = code.Accesses1();
+    const std::uint8_t *registers1 = code.Registers1();
+    const std::uint8_t *accesses2 = code.Accesses2();
+    const std::uint8_t *registers2 = code.Registers2();
+    const Word *immediates = code.Immediates();
+    const Word *targets = code.Targets();
+
+    const void *const *table = EXECUTE;
+    std::uint32_t pc = 0;
+    std::uint64_t executed = 0;
+
+#define DISPATCH()                                                                      \
+    do {                                                                                \
+        pc = machine.Fetch(registers[IP_INDEX]);                                        \
+        if constexpr (MODE == Mode::COUNTING) {                                         \
+            ++executed;                                                                 \
+        }                                                                               \
+        if constexpr (MODE == Mode::PROFILING) {                                        \
+            profiler->Execute(registers[IP_INDEX], opcodes[pc]);                        \
+        }                                                                               \
+        goto *table[opcodes[pc]];                                                       \
+    } while (false)
+
+#define NEXT()                                                                          \
+    do {                                                                                \
+        registers[IP_INDEX] = WrapAdd(registers[IP_INDEX], 1);                          \
+        DISPATCH();                                                                     \
+    } while (false)
+
+#define JUMPED()                                                                        \
+    do {                                                                                \
+        if constexpr (MODE == Mode::COMPILING) {                                        \
+            jit->Enter();                                                               \
+        }                                                                               \
+        DISPATCH();                                                                     \
+    } while (false)
+
+#define ARG1() machine.Value(registers1[pc], accesses1[pc])
+#define ARG2() machine.Value(registers2[pc], accesses2[pc])
+
+    DISPATCH();
+
+mov: {
+    Word destination = ARG1();
+    machine.Store(destination, ARG2());
+    NEXT();
+}
+
+// Arithmetic reads the register itself and writes through the access level.
+add: {
+    Word destination = ARG1();
+    Word term = ARG2();
+    machine.Store(destination, WrapAdd(registers[registers1[pc]], term));
+    NEXT();
+}
+
+sub: {
+    Word destination = ARG1();
+    Word term = ARG2();
+    machine.Store(destination, WrapSub(registers[registers1[pc]], term));
+    NEXT();
+}
+
+addi: {
+    Word destination = ARG1();
+    machine.Store(destination, WrapAdd(registers[registers1[pc]], immediates[pc]));
+    NEXT();
+}
+
+subi: {
+    Word destination = ARG1();
+    machine.Store(destination, WrapSub(registers[registers1[pc]], immediates[pc]));
+    NEXT();
+}
+
+pop: {
+    registers[SP_INDEX] = WrapAdd(registers[SP_INDEX], 1);
+    NEXT();
+}
+
+// The value is read after `sp` moves.
+push: {
+    registers[SP_INDEX] = WrapSub(registers[SP_INDEX], 1);
+    machine.Store(registers[SP_INDEX], ARG1());
+    NEXT();
+}
+
+call: {
+    Word slot = immediates[pc];
+    registers[SP_INDEX] = WrapSub(registers[SP_INDEX], 1);
+    machine.Store(registers[SP_INDEX], WrapAdd(registers[IP_INDEX], 1));
+    std::int64_t start = code.FunctionStart(slot);
+    if (start == DecodedCode::UNDEFINED) {
+        throw VmError("KeyError: " + std::to_string(code.FunctionNumber(slot)));
+    }
+    if constexpr (MODE == Mode::PROFILING) {
+        profiler->Call(code.FunctionNumber(slot), WrapAdd(registers[IP_INDEX], 1));
+    }
+    registers[IP_INDEX] = static_cast<Word>(start);
+    JUMPED();
+}
+
+indir_call: {
+    Word function_number = ARG1();
+    registers[SP_INDEX] = WrapSub(registers[SP_INDEX], 1);
+    machine.Store(registers[SP_INDEX], WrapAdd(registers[IP_INDEX], 1));
+    Word slot = code.FunctionSlot(function_number);
+    std::int64_t start = slot == DecodedCode::NO_TARGET ? DecodedCode::UNDEFINED : code.FunctionStart(slot);
+    if (start == DecodedCode::UNDEFINED) {
+        throw VmError("KeyError: " + std::to_string(function_number));
+    }
+    if constexpr (MODE == Mode::PROFILING) {
+        profiler->Call(function_number, WrapAdd(registers[IP_INDEX], 1));
+    }
+    registers[IP_INDEX] = static_cast<Word>(start);
+    JUMPED();
+}
+
+fbegin: {
+    code.DefineFunction(immediates[pc], WrapAdd(registers[IP_INDEX], 1));
+    if (targets[pc] != DecodedCode::NO_TARGET) {
+        registers[IP_INDEX] = targets[pc];
+        DISPATCH();
+    }
+    table = SKIP;
+    NEXT();
+}
+
+fend: {
+    table = EXECUTE;
+    NEXT();
+}
+
+skip: {
+    NEXT();
+}
+
+jump: {
+    registers[IP_INDEX] = ARG1();
+    if constexpr (MODE == Mode::PROFILING) {
+        profiler->Jump(registers[IP_INDEX]);
+    }
+    JUMPED();
+}
+
+jump_if_gz: {
+    registers[IP_INDEX] = ARG1() > 0 ? targets[pc] : WrapAdd(registers[IP_INDEX], 1);
+    JUMPED();
+}
+
+print: {
+    machine.Print(ARG1());
+    NEXT();
+}
+
+read: {
+    Word destination = ARG1();
+    machine.Store(destination, machine.ReadValue());
+    NEXT();
+}
+
+printstr: {
+    machine.PrintString(immediates[pc]);
+    NEXT();
+}
+
+loadl: {
+    if (immediates[pc] >= 1 << 16) {
+        throw VmError("AssertionError: LOADL immediate " + std::to_string(immediates[pc]));
+    }
+    Word destination = ARG1();
+    machine.Store(destination, LoadLow(machine.At(destination), static_cast<std::uint32_t>(immediates[pc])));
+    NEXT();
+}
+
+loadh: {
+    if (immediates[pc] >= 1 << 16) {
+        throw VmError("AssertionError: LOADH immediate " + std::to_string(immediates[pc]));
+    }
+    Word destination = ARG1();
+    machine.Store(destination, LoadHigh(machine.At(destination), static_cast<std::uint32_t>(immediates[pc])));
+    NEXT();
+}
+
+unknown:
+    throw VmError("RuntimeError: Unknown instruction: " +
+                  ToBinary(static_cast<std::uint32_t>(machine.At(registers[IP_INDEX]))));
+
+term:
+    return executed;
+
+#undef ARG2
+#undef ARG1
+#undef JUMPED
+#undef NEXT
+#undef DISPATCH
+}
+
+}   // namespace
+
+void Interpret(Machine &machine) {
+    Run<Mode::PLAIN>(machine, nullptr, nullptr);
+}
+
+std::uint64_t InterpretCounting(Machine &machine) {
+    return Run<Mode::COUNTING>(machine, nullptr, nullptr);
+}
+
+#ifdef VM_JIT
+void InterpretCompiling(Machine &machine, Jit &jit) {
+    Run<Mode::COMPILING>(machine, &jit, nullptr);
+}
+#endif
+
+void InterpretProfiling(Machine &machine, Profiler &profiler) {
+    Run<Mode::PROFILING>(machine, nullptr, &profiler);
+}
+
+}   // namespace vm
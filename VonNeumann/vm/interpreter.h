@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "vm/machine.h"
+
+namespace vm {
+
+// Runs the program until TERM, like `Interpreter.execute` of `runtime.py`.
+// Throws VmError where `runtime.py` raises.
+void Interpret(Machine &machine);
+
+// Same, returns the number of instructions run.
+std::uint64_t InterpretCounting(Machine &machine);
+
+class Profiler;
+
+// Same, counts executions and calls in `profiler`. Finish it afterwards,
+// also when the program raises.
+void InterpretProfiling(Machine &machine, Profiler &profiler);
+
+#ifdef VM_JIT
+class Jit;
+
+// Same, runs the blocks `jit` compiles for `machine`.
+void InterpretCompiling(Machine &machine, Jit &jit);
+#endif
+
+}   // namespace vm
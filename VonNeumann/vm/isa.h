@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vm {
+
+// Same ISA as `isa.py`: 32-bit words, the opcode in the 5 high bits.
+//
+// Registers are the first MAX_REGISTERS words of memory, an argument is
+// a register number and an access level: the number of times it is read
+// through memory, 0 for the number itself.
+
+using Word = std::int32_t;
+
+enum Opcode : std::uint32_t {
+    MOV = 0,
+    ADD = 1,
+    SUB = 2,
+    POP = 3,
+    PUSH = 4,
+    CALL = 5,
+    FBEGIN = 6,
+    FEND = 7,
+    TERM = 8,
+    JUMP = 9,
+    JUMP_IF_GZ = 10,
+    PRINT = 11,
+    READ = 12,
+    PRINTSTR = 13,
+    LOADL = 14,
+    LOADH = 15,
+    ADDI = 16,
+    SUBI = 17,
+    INDIR_CALL = 18,
+};
+
+constexpr std::uint32_t OPCODES_COUNT = 19;
+// All values of the 5 opcode bits.
+constexpr std::uint32_t OPCODE_VALUES = 32;
+
+constexpr const char *OPCODE_NAMES[OPCODES_COUNT] = {
+    "MOV",
+    "ADD",
+    "SUB",
+    "POP",
+    "PUSH",
+    "CALL",
+    "FBEGIN",
+    "FEND",
+    "TERM",
+    "JUMP",
+    "JUMP_IF_GZ",
+    "PRINT",
+    "READ",
+    "PRINTSTR",
+    "LOADL",
+    "LOADH",
+    "ADDI",
+    "SUBI",
+    "INDIR_CALL",
+};
+
+constexpr Word IP_INDEX = 0;
+constexpr Word SP_INDEX = 1;
+constexpr Word RV_INDEX = 2;
+constexpr Word MAX_REGISTERS = 16;
+
+// [opcode:5][access:3][register:4][access:3][register:4][unused:13]
+// [opcode:5][access:3][register:4][immediate:20]
+// [opcode:5][immediate:27]
+
+inline std::uint32_t DecodeOpcode(std::uint32_t instruction) {
+    return instruction >> 27;
+}
+
+inline std::uint32_t DecodeAccess1(std::uint32_t instruction) {
+    return (instruction >> 24) & 0x7;
+}
+
+inline Word DecodeRegister1(std::uint32_t instruction) {
+    return static_cast<Word>((instruction >> 20) & 0xF);
+}
+
+inline std::uint32_t DecodeAccess2(std::uint32_t instruction) {
+    return (instruction >> 17) & 0x7;
+}
+
+inline Word DecodeRegister2(std::uint32_t instruction) {
+    return static_cast<Word>((instruction >> 13) & 0xF);
+}
+
+inline Word DecodeRegisterImmediate(std::uint32_t instruction) {
+    return static_cast<Word>(instruction & 0xFFFFF);
+}
+
+inline Word DecodeImmediate(std::uint32_t instruction) {
+    return static_cast<Word>(instruction & 0x7FFFFFF);
+}
+
+// Words wrap around like the `np.int32` of `runtime.py`.
+inline Word WrapAdd(Word a, Word b) {
+    return static_cast<Word>(static_cast<std::uint32_t>(a) + static_cast<std::uint32_t>(b));
+}
+
+inline Word WrapSub(Word a, Word b) {
+    return static_cast<Word>(static_cast<std::uint32_t>(a) - static_cast<std::uint32_t>(b));
+}
+
+}   // namespace vm
@@ -0,0 +1,579 @@
+#include "vm/jit.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <optional>
+
+#if !defined(__x86_64__)
+#error "the JIT emits x86-64"
+#endif
+
+namespace vm {
+
+namespace {
+
+// Jumps to an instruction before its block is compiled.
+constexpr std::uint32_t HOT = 16;
+// Counter of instructions whose block cannot be compiled.
+constexpr std::uint32_t NOT_COMPILED = UINT32_MAX;
+constexpr std::uint32_t MAX_BLOCK = 64;
+constexpr std::size_t BUFFER_SIZE = std::size_t{4} << 20;
+
+// Results of blocks: whether the interpreter runs the instruction at `ip`
+// or another block may start there.
+constexpr std::uint32_t INTERPRET = 0;
+constexpr std::uint32_t CONTINUE = 1;
+
+enum Reg : std::uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+enum Condition : std::uint8_t { BELOW = 0x2, ABOVE_OR_EQUAL = 0x3, EQUAL = 0x4, LESS_OR_EQUAL = 0xE };
+
+// Host registers of the VM registers. RAX, RCX and RDX are scratch, RDI
+// points at memory.
+constexpr Reg POOL[] = {RBX, RBP, R12, R13, R14, R15, RSI, R8, R9, R10, R11};
+
+bool CalleeSaved(Reg reg) {
+    return reg == RBX || reg == RBP || reg >= R12;
+}
+
+// The few instructions blocks need, 32-bit unless named otherwise. 32-bit
+// results clear the upper half of the register, so they index memory as is.
+class Assembler {
+public:
+    const std::vector<std::uint8_t> &Bytes() const {
+        return bytes_;
+    }
+
+    void MovImm(Reg dst, std::uint32_t imm) {
+        Rex(false, RAX, RAX, dst);
+        Byte(0xB8 + (dst & 7));
+        Imm32(imm);
+    }
+
+    void MovImm64(Reg dst, std::uint64_t imm) {
+        Rex(true, RAX, RAX, dst);
+        Byte(0xB8 + (dst & 7));
+        Imm32(static_cast<std::uint32_t>(imm));
+        Imm32(static_cast<std::uint32_t>(imm >> 32));
+    }
+
+    void Mov(Reg dst, Reg src) {
+        RegReg(0x89, dst, src);
+    }
+
+    void Add(Reg dst, Reg src) {
+        RegReg(0x01, dst, src);
+    }
+
+    void Sub(Reg dst, Reg src) {
+        RegReg(0x29, dst, src);
+    }
+
+    void AddImm(Reg dst, std::uint32_t imm) {
+        RegImm(0, dst, imm);
+    }
+
+    void SubImm(Reg dst, std::uint32_t imm) {
+        RegImm(5, dst, imm);
+    }
+
+    void CmpImm(Reg reg, std::uint32_t imm) {
+        RegImm(7, reg, imm);
+    }
+
+    // 64-bit load from `[base]`, for a base other than RSP, RBP, R12, R13.
+    void Load64(Reg dst, Reg base) {
+        Rex(true, dst, RAX, base);
+        Byte(0x8B);
+        ModRm(0, dst, base);
+    }
+
+    void CmpImm64(Reg reg, std::int8_t imm) {
+        Rex(true, RAX, RAX, reg);
+        Byte(0x83);
+        ModRm(3, 7, reg);
+        Byte(static_cast<std::uint8_t>(imm));
+    }
+
+    // Words at constant addresses of the memory in RDI.
+    void LoadSlot(Reg dst, std::uint32_t address) {
+        Rex(false, dst, RAX, RDI);
+        Byte(0x8B);
+        ModRm(2, dst, RDI);
+        Imm32(address * sizeof(Word));
+    }
+
+    void StoreSlot(std::uint32_t address, Reg src) {
+        Rex(false, src, RAX, RDI);
+        Byte(0x89);
+        ModRm(2, src, RDI);
+        Imm32(address * sizeof(Word));
+    }
+
+    void StoreSlotImm(std::uint32_t address, std::uint32_t imm) {
+        Byte(0xC7);
+        ModRm(2, 0, RDI);
+        Imm32(address * sizeof(Word));
+        Imm32(imm);
+    }
+
+    // Words at the address in `index`.
+    void LoadIndexed(Reg dst, Reg index) {
+        Rex(false, dst, index, RDI);
+        Byte(0x8B);
+        ModRm(0, dst, RSP);
+        Sib(2, index, RDI);
+    }
+
+    void StoreIndexed(Reg index, Reg src) {
+        Rex(false, src, index, RDI);
+        Byte(0x89);
+        ModRm(0, src, RSP);
+        Sib(2, index, RDI);
+    }
+
+    void Push(Reg reg) {
+        Rex(false, RAX, RAX, reg);
+        Byte(0x50 + (reg & 7));
+    }
+
+    void Pop(Reg reg) {
+        Rex(false, RAX, RAX, reg);
+        Byte(0x58 + (reg & 7));
+    }
+
+    void Ret() {
+        Byte(0xC3);
+    }
+
+    // Returns the end of the jump, to Bind its target later.
+    std::size_t JumpIf(Condition condition) {
+        Byte(0x0F);
+        Byte(0x80 | condition);
+        Imm32(0);
+        return bytes_.size();
+    }
+
+    void Bind(std::size_t jump) {
+        auto displacement = static_cast<std::uint32_t>(bytes_.size() - jump);
+        std::memcpy(&bytes_[jump - 4], &displacement, 4);
+    }
+
+private:
+    void RegReg(std::uint8_t opcode, Reg rm, Reg reg) {
+        Rex(false, reg, RAX, rm);
+        Byte(opcode);
+        ModRm(3, reg, rm);
+    }
+
+    void RegImm(std::uint32_t extension, Reg rm, std::uint32_t imm) {
+        Rex(false, RAX, RAX, rm);
+        Byte(0x81);
+        ModRm(3, extension, rm);
+        Imm32(imm);
+    }
+
+    void Rex(bool wide, Reg reg, Reg index, Reg base) {
+        auto rex = static_cast<std::uint8_t>(0x40 | wide << 3 | (reg >> 3) << 2 | (index >> 3) << 1 | base >> 3);
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+    }
+
+    void ModRm(std::uint32_t mod, std::uint32_t reg, std::uint32_t rm) {
+        Byte(static_cast<std::uint8_t>(mod << 6 | (reg & 7) << 3 | (rm & 7)));
+    }
+
+    void Sib(std::uint32_t scale, std::uint32_t index, std::uint32_t base) {
+        Byte(static_cast<std::uint8_t>(scale << 6 | (index & 7) << 3 | (base & 7)));
+    }
+
+    void Byte(std::uint8_t byte) {
+        bytes_.push_back(byte);
+    }
+
+    void Imm32(std::uint32_t imm) {
+        for (int byte = 0; byte != 4; ++byte) {
+            Byte(static_cast<std::uint8_t>(imm >> (8 * byte)));
+        }
+    }
+
+private:
+    std::vector<std::uint8_t> bytes_;
+};
+
+// One block, as `std::uint32_t block(Word *memory)`: loads the VM registers
+// it uses, runs its instructions on host registers and stores back the
+// registers it wrote before each exit. Every check of an instruction comes
+// before its first write, so a failed one exits with the state from before
+// the instruction.
+class BlockCompiler {
+public:
+    BlockCompiler(const DecodedCode &code, std::uint32_t start) : code_(code), start_(start) {}
+
+    // Empty when the first instruction is left to the interpreter.
+    std::vector<std::uint8_t> Compile() {
+        std::uint32_t end = start_;
+        Fit fit = Fit::YES;
+        bool jumps = false;
+        while (end != code_.Size() && end - start_ != MAX_BLOCK) {
+            fit = Admit(end);
+            if (fit != Fit::YES) {
+                break;
+            }
+            std::uint8_t opcode = code_.Opcodes()[end++];
+            if (opcode == JUMP || opcode == JUMP_IF_GZ || opcode == CALL) {
+                jumps = true;
+                break;
+            }
+        }
+        if (end == start_) {
+            return {};
+        }
+
+        for (std::uint32_t i = 0; i != allocated_count_; ++i) {
+            if (CalleeSaved(POOL[i])) {
+                assembler_.Push(POOL[i]);
+                saved_.push_back(POOL[i]);
+            }
+        }
+        for (std::uint32_t reg = 0; reg != MAX_REGISTERS; ++reg) {
+            if ((allocated_ >> reg & 1) != 0) {
+                assembler_.LoadSlot(hosts_[reg], reg);
+            }
+        }
+
+        for (std::uint32_t index = start_; index != end; ++index) {
+            Emit(index);
+        }
+        if (!jumps) {
+            Exit(std::nullopt, WrapAdd(code_.Begin(), static_cast<Word>(end)),
+                 fit == Fit::NOT_COMPILED ? INTERPRET : CONTINUE);
+        }
+
+        for (const SideExit &side_exit : side_exits_) {
+            for (std::size_t jump : side_exit.jumps) {
+                assembler_.Bind(jump);
+            }
+            dirty_ = side_exit.dirty;
+            Exit(std::nullopt, side_exit.ip, INTERPRET);
+        }
+        return assembler_.Bytes();
+    }
+
+private:
+    enum class Fit { YES, NOT_COMPILED, NO_REGISTERS };
+
+    struct SideExit {
+        std::vector<std::size_t> jumps;
+        Word ip;
+        std::uint32_t dirty;
+    };
+
+    // Gives host registers to the VM registers of the instruction.
+    Fit Admit(std::uint32_t index) {
+        std::uint32_t access1 = code_.Accesses1()[index];
+        std::uint32_t register1 = code_.Registers1()[index];
+        std::uint32_t access2 = code_.Accesses2()[index];
+        std::uint32_t register2 = code_.Registers2()[index];
+
+        std::uint32_t needed = 0;
+        switch (code_.Opcodes()[index]) {
+        case MOV:
+        case ADD:
+        case SUB:
+            needed |= access2 != 0 ? 1u << register2 : 0;
+            [[fallthrough]];
+        case ADDI:
+        case SUBI:
+            if (access1 == 0 && register1 == IP_INDEX) {
+                return Fit::NOT_COMPILED;
+            }
+            needed |= 1u << register1;
+            break;
+        case PUSH:
+            needed |= access1 != 0 ? 1u << register1 : 0;
+            [[fallthrough]];
+        case POP:
+        case CALL:
+            needed |= 1u << SP_INDEX;
+            break;
+        case JUMP:
+        case JUMP_IF_GZ:
+            needed |= access1 != 0 ? 1u << register1 : 0;
+            break;
+        default:
+            return Fit::NOT_COMPILED;
+        }
+
+        // `ip` is known for every instruction.
+        std::uint32_t added = needed & ~allocated_ & ~(1u << IP_INDEX);
+        if (allocated_count_ + std::popcount(added) > std::size(POOL)) {
+            return Fit::NO_REGISTERS;
+        }
+        for (std::uint32_t reg = 0; reg != MAX_REGISTERS; ++reg) {
+            if ((added >> reg & 1) != 0) {
+                hosts_[reg] = POOL[allocated_count_++];
+            }
+        }
+        allocated_ |= added;
+        return Fit::YES;
+    }
+
+    void Emit(std::uint32_t index) {
+        ip_ = WrapAdd(code_.Begin(), static_cast<Word>(index));
+        std::uint32_t access1 = code_.Accesses1()[index];
+        std::uint32_t register1 = code_.Registers1()[index];
+        std::uint32_t access2 = code_.Accesses2()[index];
+        std::uint32_t register2 = code_.Registers2()[index];
+        auto immediate = static_cast<std::uint32_t>(code_.Immediates()[index]);
+
+        switch (code_.Opcodes()[index]) {
+        case MOV:
+            Value(RCX, register2, access2);
+            Write(RCX, register1, access1);
+            break;
+        case ADD:
+            Value(RCX, register2, access2);
+            Register(RDX, register1);
+            assembler_.Add(RDX, RCX);
+            Write(RDX, register1, access1);
+            break;
+        case SUB:
+            Value(RCX, register2, access2);
+            Register(RDX, register1);
+            assembler_.Sub(RDX, RCX);
+            Write(RDX, register1, access1);
+            break;
+        case ADDI:
+            Register(RDX, register1);
+            assembler_.AddImm(RDX, immediate);
+            Write(RDX, register1, access1);
+            break;
+        case SUBI:
+            Register(RDX, register1);
+            assembler_.SubImm(RDX, immediate);
+            Write(RDX, register1, access1);
+            break;
+        case POP:
+            assembler_.AddImm(hosts_[SP_INDEX], 1);
+            dirty_ |= 1u << SP_INDEX;
+            break;
+        case PUSH:
+            // The value is read after `sp` moves.
+            assembler_.Mov(RAX, hosts_[SP_INDEX]);
+            assembler_.SubImm(RAX, 1);
+            CheckStore(RAX);
+            Value(RCX, register1, access1, RAX);
+            assembler_.Mov(hosts_[SP_INDEX], RAX);
+            assembler_.StoreIndexed(RAX, RCX);
+            dirty_ |= 1u << SP_INDEX;
+            break;
+        case CALL:
+            // Functions not defined yet raise in the interpreter.
+            assembler_.MovImm64(RDX, reinterpret_cast<std::uint64_t>(code_.FunctionStartAddress(immediate)));
+            assembler_.Load64(RDX, RDX);
+            assembler_.CmpImm64(RDX, static_cast<std::int8_t>(DecodedCode::UNDEFINED));
+            SideExitIf(EQUAL);
+            assembler_.Mov(RAX, hosts_[SP_INDEX]);
+            assembler_.SubImm(RAX, 1);
+            CheckStore(RAX);
+            assembler_.Mov(hosts_[SP_INDEX], RAX);
+            assembler_.MovImm(RCX, static_cast<std::uint32_t>(WrapAdd(ip_, 1)));
+            assembler_.StoreIndexed(RAX, RCX);
+            dirty_ |= 1u << SP_INDEX;
+            Exit(RDX, 0, CONTINUE);
+            break;
+        case JUMP:
+            Value(RAX, register1, access1);
+            Exit(RAX, 0, CONTINUE);
+            break;
+        case JUMP_IF_GZ: {
+            Value(RAX, register1, access1);
+            assembler_.CmpImm(RAX, 0);
+            std::size_t not_taken = assembler_.JumpIf(LESS_OR_EQUAL);
+            Exit(std::nullopt, code_.Targets()[index], CONTINUE);
+            assembler_.Bind(not_taken);
+            Exit(std::nullopt, WrapAdd(ip_, 1), CONTINUE);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // The register itself; `sp` replaces the stack pointer for PUSH.
+    void Register(Reg out, std::uint32_t reg, std::optional<Reg> sp = std::nullopt) {
+        if (reg == IP_INDEX) {
+            assembler_.MovImm(out, static_cast<std::uint32_t>(ip_));
+        } else if (reg == SP_INDEX && sp) {
+            assembler_.Mov(out, *sp);
+        } else {
+            assembler_.Mov(out, hosts_[reg]);
+        }
+    }
+
+    // The register number read `access` times through memory.
+    void Value(Reg out, std::uint32_t reg, std::uint32_t access, std::optional<Reg> sp = std::nullopt) {
+        if (access == 0) {
+            assembler_.MovImm(out, reg);
+            return;
+        }
+        Register(out, reg, sp);
+        for (; access > 1; --access) {
+            CheckLoad(out);
+            assembler_.LoadIndexed(out, out);
+        }
+    }
+
+    // To the register at access 0, through memory otherwise; `value` is
+    // not RAX.
+    void Write(Reg value, std::uint32_t reg, std::uint32_t access) {
+        if (access == 0) {
+            assembler_.Mov(hosts_[reg], value);
+            dirty_ |= 1u << reg;
+            return;
+        }
+        Value(RAX, reg, access);
+        CheckStore(RAX);
+        assembler_.StoreIndexed(RAX, value);
+    }
+
+    // Loads stay off the registers, which live in host registers.
+    void CheckLoad(Reg address) {
+        assembler_.CmpImm(address, MAX_REGISTERS);
+        SideExitIf(BELOW);
+        assembler_.CmpImm(address, Machine::MEMORY_SIZE);
+        SideExitIf(ABOVE_OR_EQUAL);
+    }
+
+    // Stores stay off the code too.
+    void CheckStore(Reg address) {
+        assembler_.CmpImm(address, static_cast<std::uint32_t>(WrapAdd(code_.Begin(), static_cast<Word>(code_.Size()))));
+        SideExitIf(BELOW);
+        assembler_.CmpImm(address, Machine::MEMORY_SIZE);
+        SideExitIf(ABOVE_OR_EQUAL);
+    }
+
+    void SideExitIf(Condition condition) {
+        if (side_exits_.empty() || side_exits_.back().ip != ip_) {
+            side_exits_.push_back(SideExit{{}, ip_, dirty_});
+        }
+        side_exits_.back().jumps.push_back(assembler_.JumpIf(condition));
+    }
+
+    // With `ip` from the register `ip_source`, or else `ip`.
+    void Exit(std::optional<Reg> ip_source, Word ip, std::uint32_t result) {
+        for (std::uint32_t reg = 0; reg != MAX_REGISTERS; ++reg) {
+            if ((dirty_ >> reg & 1) != 0) {
+                assembler_.StoreSlot(reg, hosts_[reg]);
+            }
+        }
+        if (ip_source) {
+            assembler_.StoreSlot(IP_INDEX, *ip_source);
+        } else {
+            assembler_.StoreSlotImm(IP_INDEX, static_cast<std::uint32_t>(ip));
+        }
+        assembler_.MovImm(RAX, result);
+        for (auto reg = saved_.rbegin(); reg != saved_.rend(); ++reg) {
+            assembler_.Pop(*reg);
+        }
+        assembler_.Ret();
+    }
+
+private:
+    const DecodedCode &code_;
+    std::uint32_t start_;
+    Assembler assembler_;
+
+    std::array<Reg, MAX_REGISTERS> hosts_ {};
+    // VM registers in host registers, and those written so far.
+    std::uint32_t allocated_ {0};
+    std::uint32_t allocated_count_ {0};
+    std::uint32_t dirty_ {0};
+    std::vector<Reg> saved_;
+
+    // Of the instruction being compiled.
+    Word ip_ {0};
+    std::vector<SideExit> side_exits_;
+};
+
+}   // namespace
+
+Jit::Jit(Machine &machine) : machine_(machine), generation_(machine.Code().Generation()) {
+    void *buffer = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    buffer_ = static_cast<std::uint8_t *>(buffer);
+    Flush();
+}
+
+Jit::~Jit() {
+    munmap(buffer_, BUFFER_SIZE);
+}
+
+void Jit::Enter() {
+    DecodedCode &code = machine_.Code();
+    if (code.Generation() != generation_) [[unlikely]] {
+        Flush();
+    }
+
+    Word *memory = machine_.Registers();
+    for (;;) {
+        auto index = static_cast<std::uint32_t>(WrapSub(memory[IP_INDEX], code.Begin()));
+        if (index >= code.Size()) {
+            return;
+        }
+        Block block = blocks_[index];
+        if (block == nullptr) [[unlikely]] {
+            if (counters_[index] == NOT_COMPILED || ++counters_[index] < HOT) {
+                return;
+            }
+            block = Compile(index);
+            if (block == nullptr) {
+                counters_[index] = NOT_COMPILED;
+                return;
+            }
+        }
+        if (block(memory) == INTERPRET) {
+            return;
+        }
+    }
+}
+
+Jit::Block Jit::Compile(std::uint32_t index) {
+    std::vector<std::uint8_t> bytes = BlockCompiler(machine_.Code(), index).Compile();
+    if (bytes.empty() || bytes.size() > BUFFER_SIZE) {
+        return nullptr;
+    }
+    if (bytes.size() > BUFFER_SIZE - used_) {
+        Flush();
+    }
+
+    // Writable only while a block is copied in.
+    mprotect(buffer_, BUFFER_SIZE, PROT_READ | PROT_WRITE);
+    std::memcpy(buffer_ + used_, bytes.data(), bytes.size());
+    mprotect(buffer_, BUFFER_SIZE, PROT_READ | PROT_EXEC);
+
+    auto block = reinterpret_cast<Block>(buffer_ + used_);
+    used_ = std::min(BUFFER_SIZE, (used_ + bytes.size() + 15) & ~std::size_t{15});
+    blocks_[index] = block;
+    ++compiled_;
+    return block;
+}
+
+void Jit::Flush() {
+    const DecodedCode &code = machine_.Code();
+    generation_ = code.Generation();
+    blocks_.assign(code.Size(), nullptr);
+    counters_.assign(code.Size(), 0);
+    used_ = 0;
+}
+
+}   // namespace vm
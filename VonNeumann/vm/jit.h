@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vm/isa.h"
+#include "vm/machine.h"
+
+namespace vm {
+
+// Second tier of the interpreter, for x86-64 Linux. Instructions jumped to
+// often start basic blocks compiled to native code in `mmap`'d memory;
+// the VM registers a block uses stay in host registers until it exits.
+//
+// Blocks end at JUMP, JUMP_IF_GZ and CALL, and exit to the interpreter
+// before the instructions they leave to it: INDIR_CALL, input and output,
+// FBEGIN and FEND, LOADL and LOADH, writes to `ip`. Memory accesses that
+// would reach the registers, the code or outside memory exit the same way,
+// so the interpreter raises its errors and decodes writes into the code,
+// after which every block is dropped.
+class Jit {
+public:
+    explicit Jit(Machine &machine);
+    ~Jit();
+
+    Jit(const Jit &) = delete;
+    Jit &operator=(const Jit &) = delete;
+
+    // After a jump, with the target in `ip`: runs compiled blocks for as
+    // long as they jump to other compiled blocks, and compiles the hot
+    // ones. Returns with `ip` where the interpreter goes on.
+    void Enter();
+
+    std::size_t CompiledBlocks() const {
+        return compiled_;
+    }
+
+private:
+    // Returns INTERPRET when the interpreter has to run the instruction at
+    // `ip`, stored back to memory with the registers.
+    using Block = std::uint32_t (*)(Word *memory);
+
+    Block Compile(std::uint32_t index);
+    void Flush();
+
+private:
+    Machine &machine_;
+    std::uint64_t generation_;
+    std::vector<Block> blocks_;
+    // Jumps to each instruction of the code while it has no block.
+    std::vector<std::uint32_t> counters_;
+
+    std::uint8_t *buffer_;
+    std::size_t used_ {0};
+    std::size_t compiled_ {0};
+};
+
+}   // namespace vm
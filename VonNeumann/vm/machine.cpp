@@ -0,0 +1,195 @@
+#include "vm/machine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <new>
+
+namespace vm {
+
+Program LoadProgram(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw VmError("FileNotFoundError: " + path);
+    }
+    std::vector<char> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    // Like `np.fromfile`, a trailing partial word is dropped.
+    std::vector<Word> words(bytes.size() / sizeof(Word));
+    for (std::size_t i = 0; i != words.size(); ++i) {
+        std::uint32_t word = 0;
+        for (std::size_t byte = 0; byte != sizeof(Word); ++byte) {
+            word |= static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i * sizeof(Word) + byte])) << (8 * byte);
+        }
+        words[i] = static_cast<Word>(word);
+    }
+    if (words.empty()) {
+        throw VmError("IndexError: empty program " + path);
+    }
+    return Program{words[0], std::vector<Word>(words.begin() + 1, words.end())};
+}
+
+namespace {
+
+// Words of the code actually in the program.
+std::uint32_t CodeSize(const Program &program) {
+    if (program.code_size <= 0) {
+        return 0;
+    }
+    return static_cast<std::uint32_t>(std::min<std::size_t>(static_cast<std::size_t>(program.code_size),
+                                                            program.words.size()));
+}
+
+}   // namespace
+
+Machine::Machine(const Program &program, std::istream &input, std::FILE *output)
+        : memory_(Load(program)), static_offset_(WrapAdd(MAX_REGISTERS, program.code_size)),
+          code_(memory_.get(), MAX_REGISTERS, CodeSize(program)), input_(input), output_(output) {}
+
+Machine::Memory Machine::Load(const Program &program) {
+    Memory memory(static_cast<Word *>(std::calloc(MEMORY_SIZE, sizeof(Word))));
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    if (program.words.size() > static_cast<std::size_t>(MEMORY_SIZE - MAX_REGISTERS)) {
+        throw VmError("IndexError: program of " + std::to_string(program.words.size()) +
+                      " words does not fit in memory");
+    }
+    memory[IP_INDEX] = MAX_REGISTERS;
+    memory[SP_INDEX] = MEMORY_SIZE;
+    std::copy(program.words.begin(), program.words.end(), memory.get() + MAX_REGISTERS);
+    return memory;
+}
+
+Word &Machine::AtSlow(Word address) {
+    if (address < 0 && address >= -MEMORY_SIZE) {
+        return memory_[MEMORY_SIZE + address];
+    }
+    throw VmError("IndexError: index " + std::to_string(address) + " is out of bounds for axis 0 with size " +
+                  std::to_string(MEMORY_SIZE));
+}
+
+void Machine::Print(Word value) {
+    std::fprintf(output_, "%d\n", value);
+}
+
+void Machine::PrintString(Word string_number) {
+    Word string_address = At(WrapAdd(static_offset_, string_number));
+    Word length = At(WrapAdd(static_offset_, string_address));
+
+    std::string text;
+    for (Word i = 0; i < length; ++i) {
+        Word code = At(WrapAdd(WrapAdd(static_offset_, string_address), WrapAdd(i, 1)));
+        // `chr` of the code, printed as UTF-8.
+        if (code < 0 || code > 0x10FFFF) {
+            throw VmError("ValueError: chr() arg not in range(0x110000)");
+        }
+        if (code >= 0xD800 && code <= 0xDFFF) {
+            throw VmError("UnicodeEncodeError: surrogates not allowed");
+        }
+        auto point = static_cast<std::uint32_t>(code);
+        if (point < 0x80) {
+            text += static_cast<char>(point);
+        } else if (point < 0x800) {
+            text += static_cast<char>(0xC0 | (point >> 6));
+            text += static_cast<char>(0x80 | (point & 0x3F));
+        } else if (point < 0x10000) {
+            text += static_cast<char>(0xE0 | (point >> 12));
+            text += static_cast<char>(0x80 | ((point >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (point & 0x3F));
+        } else {
+            text += static_cast<char>(0xF0 | (point >> 18));
+            text += static_cast<char>(0x80 | ((point >> 12) & 0x3F));
+            text += static_cast<char>(0x80 | ((point >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (point & 0x3F));
+        }
+    }
+    text += '\n';
+    std::fwrite(text.data(), 1, text.size(), output_);
+}
+
+Word Machine::ReadValue() {
+    std::fflush(output_);
+
+    std::string line;
+    if (!std::getline(input_, line)) {
+        throw VmError("EOFError: EOF when reading a line");
+    }
+
+    // `int(line)`: surrounding whitespace, a sign, digits with single
+    // underscores between them.
+    std::size_t begin = 0;
+    std::size_t end = line.size();
+    while (begin != end && std::isspace(static_cast<unsigned char>(line[begin]))) {
+        ++begin;
+    }
+    while (end != begin && std::isspace(static_cast<unsigned char>(line[end - 1]))) {
+        --end;
+    }
+    bool negative = false;
+    if (begin != end && (line[begin] == '+' || line[begin] == '-')) {
+        negative = line[begin] == '-';
+        ++begin;
+    }
+    bool valid = begin != end;
+    std::int64_t magnitude = 0;
+    for (std::size_t i = begin; valid && i != end; ++i) {
+        char c = line[i];
+        if (c == '_' && i != begin && i + 1 != end && line[i - 1] != '_') {
+            continue;
+        }
+        valid = std::isdigit(static_cast<unsigned char>(c)) != 0;
+        magnitude = std::min<std::int64_t>(magnitude * 10 + (c - '0'), std::int64_t{1} << 32);
+    }
+    if (!valid) {
+        throw VmError("ValueError: invalid literal for int() with base 10: '" + line + "'");
+    }
+
+    std::int64_t value = negative ? -magnitude : magnitude;
+    if (value < INT32_MIN || value > INT32_MAX) {
+        throw VmError("OverflowError: Python integer " + line.substr(0, end) + " out of bounds for int32");
+    }
+    return static_cast<Word>(value);
+}
+
+namespace {
+
+// Digits of the magnitude in `format(word, "032b")`.
+struct SignMagnitude {
+    std::uint64_t magnitude;
+    int digits;
+};
+
+SignMagnitude Split(Word word) {
+    std::uint64_t magnitude = static_cast<std::uint64_t>(-static_cast<std::int64_t>(word));
+    // The sign takes one of the 32 characters, INT32_MIN needs one more.
+    return SignMagnitude{magnitude, magnitude >> 31 != 0 ? 32 : 31};
+}
+
+}   // namespace
+
+Word LoadLow(Word previous, std::uint32_t immediate) {
+    if (previous >= 0) {
+        return static_cast<Word>((static_cast<std::uint32_t>(previous) & 0xFFFF0000u) | immediate);
+    }
+    // The sign and the 15 high digits, then the immediate.
+    SignMagnitude split = Split(previous);
+    std::uint64_t high = split.magnitude >> (split.digits - 15);
+    return static_cast<Word>(-static_cast<std::int64_t>((high << 16) | immediate));
+}
+
+Word LoadHigh(Word previous, std::uint32_t immediate) {
+    if (previous >= 0) {
+        return static_cast<Word>((immediate << 16) | (static_cast<std::uint32_t>(previous) & 0xFFFF));
+    }
+    // The immediate, then the digits after the first 16 characters.
+    SignMagnitude split = Split(previous);
+    int low_digits = split.digits - 15;
+    std::uint64_t low = split.magnitude & ((std::uint64_t{1} << low_digits) - 1);
+    return static_cast<Word>((static_cast<std::uint64_t>(immediate) << low_digits) | low);
+}
+
+}   // namespace vm
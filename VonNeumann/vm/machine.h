@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "vm/decoded.h"
+#include "vm/isa.h"
+
+namespace vm {
+
+// Errors that end `runtime.py` with a Python exception.
+class VmError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Layout written by `asm2bin.py`: the instruction count, the instructions,
+// then the string table.
+struct Program {
+    Word code_size;
+    // Instructions and string table.
+    std::vector<Word> words;
+};
+
+Program LoadProgram(const std::string &path);
+
+// Memory and state of `runtime.py`: the program is loaded after the
+// registers, `ip` points at it and `sp` at the end of memory.
+class Machine {
+public:
+    static constexpr Word MEMORY_SIZE = 10000000;
+
+    explicit Machine(const Program &program, std::istream &input = std::cin, std::FILE *output = stdout);
+
+    // Negative addresses count from the end of memory, like numpy indices.
+    Word &At(Word address) {
+        if (static_cast<std::uint32_t>(address) < static_cast<std::uint32_t>(MEMORY_SIZE)) [[likely]] {
+            return memory_[static_cast<std::uint32_t>(address)];
+        }
+        return AtSlow(address);
+    }
+
+    // The register number read `access` times through memory.
+    Word Value(Word reg, std::uint32_t access) {
+        for (; access != 0; --access) {
+            reg = At(reg);
+        }
+        return reg;
+    }
+
+    // Writes into the code are decoded again.
+    void Store(Word address, Word value) {
+        Word &word = At(address);
+        word = value;
+        auto index = static_cast<std::uint32_t>(&word - memory_.get() - code_.Begin());
+        if (index < code_.Size()) [[unlikely]] {
+            code_.Redecode(index, value);
+        }
+    }
+
+    // Entry of the instruction at `ip` in the decoded code.
+    std::uint32_t Fetch(Word ip) {
+        auto index = static_cast<std::uint32_t>(WrapSub(ip, code_.Begin()));
+        if (index < code_.Size()) [[likely]] {
+            return index;
+        }
+        return code_.DecodeOutside(ip, At(ip));
+    }
+
+    Word *Registers() {
+        return memory_.get();
+    }
+
+    DecodedCode &Code() {
+        return code_;
+    }
+
+    // Input and output as with `print` and `input` in `runtime.py`.
+    void Print(Word value);
+    void PrintString(Word string_number);
+    Word ReadValue();
+
+private:
+    struct Free {
+        void operator()(Word *words) const {
+            std::free(words);
+        }
+    };
+
+    using Memory = std::unique_ptr<Word[], Free>;
+
+    static Memory Load(const Program &program);
+
+    Word &AtSlow(Word address);
+
+private:
+    // From `calloc`, which maps zeroed pages without touching them.
+    Memory memory_;
+    Word static_offset_;
+    DecodedCode code_;
+    std::istream &input_;
+    std::FILE *output_;
+};
+
+// LOADL and LOADH splice the binary string of the previous word, which for
+// negative words is a sign and the magnitude rather than two's complement.
+Word LoadLow(Word previous, std::uint32_t immediate);
+Word LoadHigh(Word previous, std::uint32_t immediate);
+
+}   // namespace vm
@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "vm/interpreter.h"
+#include "vm/machine.h"
+#include "vm/profiler.h"
+
+#ifdef VM_JIT
+#include "vm/jit.h"
+#endif
+
+namespace {
+
+// PREFIX.txt for the report, PREFIX.folded for flame graphs.
+void WriteProfile(vm::Profiler &profiler, const std::string &prefix) {
+    profiler.Finish();
+    for (const char *extension : {".txt", ".folded"}) {
+        std::string path = prefix + extension;
+        std::FILE *file = std::fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            throw vm::VmError("OSError: cannot write " + path);
+        }
+        if (std::strcmp(extension, ".txt") == 0) {
+            profiler.WriteReport(file);
+        } else {
+            profiler.WriteFoldedStacks(file);
+        }
+        std::fclose(file);
+    }
+}
+
+}   // namespace
+
+// Same command line and output as `python3 runtime.py PROGRAM.bin`. After
+// the program, where `runtime.py` takes DEBUG: JIT compiles hot blocks to
+// native code, PROFILE writes a profile of the run to PREFIX.txt and
+// PREFIX.folded, `profile` by default.
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s PROGRAM.bin [JIT | PROFILE [PREFIX]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool jit = argc == 3 && std::strcmp(argv[2], "JIT") == 0;
+    bool profile = (argc == 3 || argc == 4) && std::strcmp(argv[2], "PROFILE") == 0;
+    std::string prefix = argc == 4 ? argv[3] : "profile";
+
+    try {
+        vm::Program program = vm::LoadProgram(argv[1]);
+        vm::Machine machine(program);
+        if (jit) {
+#ifdef VM_JIT
+            vm::Jit compiler(machine);
+            vm::InterpretCompiling(machine, compiler);
+#else
+            std::fprintf(stderr, "JIT needs x86-64 Linux, interpreting\n");
+            vm::Interpret(machine);
+#endif
+        } else if (profile) {
+            vm::Profiler profiler(machine.Code());
+            try {
+                vm::InterpretProfiling(machine, profiler);
+            } catch (const vm::VmError &) {
+                WriteProfile(profiler, prefix);
+                throw;
+            }
+            WriteProfile(profiler, prefix);
+        } else {
+            vm::Interpret(machine);
+        }
+    } catch (const vm::VmError &error) {
+        std::fflush(stdout);
+        std::fprintf(stderr, "%s\n", error.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
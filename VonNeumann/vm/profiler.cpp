@@ -0,0 +1,177 @@
+#include "vm/profiler.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace vm {
+
+namespace {
+
+constexpr std::size_t HOT_ADDRESSES = 20;
+
+const char *OpcodeName(std::uint32_t opcode) {
+    return opcode < OPCODES_COUNT ? OPCODE_NAMES[opcode] : "unknown";
+}
+
+double Percent(std::uint64_t part, std::uint64_t total) {
+    return total == 0 ? 0 : 100.0 * static_cast<double>(part) / static_cast<double>(total);
+}
+
+double Milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+std::string FunctionName(Word function_number) {
+    std::string name = std::to_string(function_number);
+    name.insert(name.begin(), 'f');
+    return name;
+}
+
+}   // namespace
+
+Profiler::Profiler(const DecodedCode &code)
+        : code_(code), addresses_(code.Size()), start_(Clock::now()), last_(start_) {
+    nodes_.push_back(Node{0, ROOT, {}});
+}
+
+void Profiler::Call(Word function_number, Word return_address) {
+    Clock::time_point now = Clock::now();
+    Charge(now);
+
+    auto [child, inserted] =
+        nodes_[current_].children.emplace(function_number, static_cast<std::uint32_t>(nodes_.size()));
+    std::uint32_t node = child->second;
+    if (inserted) {
+        auto [index, added] =
+            function_indices_.emplace(function_number, static_cast<std::uint32_t>(functions_.size()));
+        if (added) {
+            functions_.push_back(Function{function_number});
+        }
+        nodes_.push_back(Node{index->second, current_, {}});
+    }
+    frames_.push_back(Frame{node, return_address, executed_, now});
+
+    Function &function = functions_[nodes_[node].function];
+    ++function.calls;
+    ++function.active;
+    current_ = node;
+}
+
+void Profiler::Return() {
+    Clock::time_point now = Clock::now();
+    Charge(now);
+
+    Frame frame = frames_.back();
+    frames_.pop_back();
+    Function &function = functions_[nodes_[frame.node].function];
+    if (--function.active == 0) {
+        function.inclusive_instructions += executed_ - frame.executed;
+        function.inclusive_time += now - frame.start;
+    }
+    current_ = nodes_[frame.node].parent;
+}
+
+void Profiler::Finish() {
+    while (!frames_.empty()) {
+        Return();
+    }
+    Charge(Clock::now());
+}
+
+void Profiler::Charge(Clock::time_point now) {
+    Node &node = nodes_[current_];
+    node.instructions += executed_ - last_executed_;
+    node.time += now - last_;
+    last_executed_ = executed_;
+    last_ = now;
+}
+
+void Profiler::WriteReport(std::FILE *file) const {
+    std::fprintf(file, "instructions %llu\n", static_cast<unsigned long long>(executed_));
+    std::fprintf(file, "time_ms %.3f\n", Milliseconds(last_ - start_));
+
+    std::fprintf(file, "\n%-12s %14s %7s\n", "opcode", "count", "%");
+    std::vector<std::uint32_t> opcodes;
+    for (std::uint32_t opcode = 0; opcode != OPCODE_VALUES; ++opcode) {
+        if (opcodes_[opcode] != 0) {
+            opcodes.push_back(opcode);
+        }
+    }
+    std::stable_sort(opcodes.begin(), opcodes.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return opcodes_[a] > opcodes_[b]; });
+    for (std::uint32_t opcode : opcodes) {
+        std::fprintf(file, "%-12s %14llu %7.2f\n", OpcodeName(opcode),
+                     static_cast<unsigned long long>(opcodes_[opcode]), Percent(opcodes_[opcode], executed_));
+    }
+
+    // Addresses outside the code have no decoded opcode.
+    std::vector<std::pair<Word, std::uint64_t>> addresses(outside_.begin(), outside_.end());
+    for (std::uint32_t index = 0; index != addresses_.size(); ++index) {
+        if (addresses_[index] != 0) {
+            addresses.emplace_back(WrapAdd(code_.Begin(), static_cast<Word>(index)), addresses_[index]);
+        }
+    }
+    std::size_t hot = std::min(addresses.size(), HOT_ADDRESSES);
+    std::partial_sort(addresses.begin(), addresses.begin() + static_cast<std::ptrdiff_t>(hot), addresses.end(),
+                      [](const auto &a, const auto &b) {
+                          return a.second > b.second || (a.second == b.second && a.first < b.first);
+                      });
+    std::fprintf(file, "\n%-10s %-12s %14s %7s\n", "address", "opcode", "count", "%");
+    for (std::size_t i = 0; i != hot; ++i) {
+        auto [address, count] = addresses[i];
+        auto index = static_cast<std::uint32_t>(WrapSub(address, code_.Begin()));
+        std::fprintf(file, "%-10d %-12s %14llu %7.2f\n", address,
+                     index < code_.Size() ? OpcodeName(code_.Opcodes()[index]) : "-",
+                     static_cast<unsigned long long>(count), Percent(count, executed_));
+    }
+
+    // Exclusive cost of a function is that of all its stacks.
+    struct Row {
+        std::string name;
+        std::uint64_t calls;
+        std::uint64_t inclusive_instructions;
+        std::uint64_t exclusive_instructions;
+        Clock::duration inclusive_time;
+        Clock::duration exclusive_time;
+    };
+    std::vector<Row> rows;
+    rows.push_back(Row{"main", 1, executed_, 0, last_ - start_, {}});
+    for (const Function &function : functions_) {
+        rows.push_back(Row{FunctionName(function.number), function.calls, function.inclusive_instructions, 0,
+                           function.inclusive_time, {}});
+    }
+    for (std::uint32_t node = 0; node != nodes_.size(); ++node) {
+        Row &row = rows[node == ROOT ? 0 : nodes_[node].function + 1];
+        row.exclusive_instructions += nodes_[node].instructions;
+        row.exclusive_time += nodes_[node].time;
+    }
+    std::sort(rows.begin() + 1, rows.end(), [](const Row &a, const Row &b) {
+        return a.inclusive_instructions > b.inclusive_instructions ||
+               (a.inclusive_instructions == b.inclusive_instructions && a.name < b.name);
+    });
+
+    std::fprintf(file, "\n%-12s %10s %14s %14s %12s %12s\n", "function", "calls", "incl_instr", "excl_instr",
+                 "incl_ms", "excl_ms");
+    for (const Row &row : rows) {
+        std::fprintf(file, "%-12s %10llu %14llu %14llu %12.3f %12.3f\n", row.name.c_str(),
+                     static_cast<unsigned long long>(row.calls),
+                     static_cast<unsigned long long>(row.inclusive_instructions),
+                     static_cast<unsigned long long>(row.exclusive_instructions), Milliseconds(row.inclusive_time),
+                     Milliseconds(row.exclusive_time));
+    }
+}
+
+void Profiler::WriteFoldedStacks(std::FILE *file) const {
+    // Parents come before their children.
+    std::vector<std::string> stacks(nodes_.size());
+    for (std::uint32_t node = 0; node != nodes_.size(); ++node) {
+        stacks[node] = node == ROOT ? "main" : stacks[nodes_[node].parent] + ";" +
+                                                   FunctionName(functions_[nodes_[node].function].number);
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(nodes_[node].time).count();
+        if (nanoseconds != 0) {
+            std::fprintf(file, "%s %lld\n", stacks[node].c_str(), static_cast<long long>(nanoseconds));
+        }
+    }
+}
+
+}   // namespace vm
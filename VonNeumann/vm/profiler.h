@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vm/decoded.h"
+#include "vm/isa.h"
+
+namespace vm {
+
+// Where a program spends its instructions and time, gathered by the
+// interpreter as it runs: executions per opcode and per address, and the
+// calls between functions.
+//
+// A CALL or INDIR_CALL enters the function with that number, and a JUMP to
+// the address after the innermost call returns from it. Functions left
+// without a return end with the program. Inclusive cost of a recursive
+// function counts its outermost calls only.
+class Profiler {
+public:
+    explicit Profiler(const DecodedCode &code);
+
+    void Execute(Word ip, std::uint32_t opcode) {
+        ++executed_;
+        ++opcodes_[opcode];
+        auto index = static_cast<std::uint32_t>(WrapSub(ip, code_.Begin()));
+        if (index < code_.Size()) [[likely]] {
+            ++addresses_[index];
+        } else {
+            ++outside_[ip];
+        }
+    }
+
+    void Call(Word function_number, Word return_address);
+
+    void Jump(Word target) {
+        if (!frames_.empty() && frames_.back().return_address == target) {
+            Return();
+        }
+    }
+
+    // Ends the calls still running, once the program stops.
+    void Finish();
+
+    // Totals, opcodes, the hottest addresses and the functions.
+    void WriteReport(std::FILE *file) const;
+
+    // One line per call stack with its exclusive time in nanoseconds, as
+    // read by `flamegraph.pl`.
+    void WriteFoldedStacks(std::FILE *file) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::uint32_t ROOT = 0;
+
+    // Call stacks as a tree, one node per distinct stack.
+    struct Node {
+        // Index in `functions_`, unused by the root.
+        std::uint32_t function;
+        std::uint32_t parent;
+        std::unordered_map<Word, std::uint32_t> children;
+        std::uint64_t instructions {0};
+        Clock::duration time {};
+    };
+
+    struct Frame {
+        std::uint32_t node;
+        Word return_address;
+        std::uint64_t executed;
+        Clock::time_point start;
+    };
+
+    struct Function {
+        Word number;
+        std::uint64_t calls {0};
+        std::uint32_t active {0};
+        std::uint64_t inclusive_instructions {0};
+        Clock::duration inclusive_time {};
+    };
+
+    void Return();
+    // Charges the cost since the last call or return to the current stack.
+    void Charge(Clock::time_point now);
+
+private:
+    const DecodedCode &code_;
+
+    std::uint64_t executed_ {0};
+    std::array<std::uint64_t, OPCODE_VALUES> opcodes_ {};
+    std::vector<std::uint64_t> addresses_;
+    std::unordered_map<Word, std::uint64_t> outside_;
+
+    std::vector<Node> nodes_;
+    std::vector<Frame> frames_;
+    std::vector<Function> functions_;
+    std::unordered_map<Word, std::uint32_t> function_indices_;
+    std::uint32_t current_ {ROOT};
+    Clock::time_point start_;
+    Clock::time_point last_;
+    std::uint64_t last_executed_ {0};
+};
+
+}   // namespace vm